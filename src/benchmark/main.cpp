@@ -0,0 +1,462 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <raz/bitset.hpp>
+#include <raz/network.hpp>
+#include <raz/random.hpp>
+#include "common/IApplication.hpp"
+#include "common/PlayerManager.hpp"
+#include "gameworld/GameWorld.hpp"
+#include "gameworld/InputLog.hpp"
+
+extern bool g_batchSolve; // b2ContactSolver.cpp
+
+/*
+ * Steps a GameWorld through reproducible scenes and prints per-phase timings
+ * as CSV, one line per scene.
+ *
+ * usage: razzgravitas-benchmark [ticks] [seed] [scene|all|replay:<input log>|serializer|bitset] [max players] [max objects per player] [broad-phase rebuild threshold] [solver threads] [batched contact solver 0|1] [ccd motion ratio]
+ *
+ * A replay feeds an input log recorded by a host (INPUT_LOG_FILE) back through the world as fast
+ * as it can, for at least [ticks] ticks and until the log is over. The capacity comes from the log.
+ *
+ * The serializer and bitset scenes are micro benchmarks that only run when named, and print their own CSV.
+ */
+
+class BenchmarkApplication : public IApplication
+{
+public:
+	BenchmarkApplication(uint16_t max_players, uint16_t max_game_objects_per_player, bool add_players)
+	{
+		m_player_mgr.setCapacity(max_players, max_game_objects_per_player);
+
+		// replayed players join from the log
+		while (add_players && m_player_mgr.addPlayer());
+	}
+
+	virtual GameMode getGameMode() const { return GameMode::SingplePlay; }
+	virtual PlayerManager* getPlayerManager() { return &m_player_mgr; }
+	virtual void exit(int exit_code, const char* msg) { std::fprintf(stderr, "exit(%d): %s\n", exit_code, msg ? msg : ""); }
+	virtual void handle(Connected e, EventSource src) {}
+	virtual void handle(Disconnected e, EventSource src) {}
+	virtual void handle(SwitchPlayer e, EventSource src) {}
+	virtual void handle(Message e, EventSource src) {}
+	virtual void handle(AddGameObject e, EventSource src) {}
+	virtual void handle(RemoveGameObjectsNearMouse e, EventSource src) {}
+	virtual void handle(RemoveGameObject e, EventSource src) {}
+	virtual void handle(RemovePlayerGameObjects e, EventSource src) {}
+	virtual void handle(GameObjectSync e, EventSource src) { synced_objects += e.object_count; }
+	virtual void handle(const std::vector<GameObjectSync>& batch, EventSource src) { for (auto& e : batch) synced_objects += e.object_count; }
+	virtual void handle(GameObjectSyncRequest e, EventSource src) {}
+	virtual void handle(Highscore e, EventSource src) {}
+
+	uint64_t synced_objects = 0;
+
+private:
+	PlayerManager m_player_mgr;
+};
+
+class GameWorldBenchmark
+{
+public:
+	enum Scene
+	{
+		UniformCloud,
+		BinaryClusters,
+		MergeCascade,
+		MaxCapacity,
+		SceneCount
+	};
+
+	struct Result
+	{
+		size_t bodies_start = 0;
+		size_t bodies_end = 0;
+		size_t merges = 0;
+		size_t escaped = 0; // bodies that tunnelled through the level bounds
+		double gravity_ms = 0.0;
+		double step_ms = 0.0;
+		double broadphase_ms = 0.0; // part of step_ms
+		double toi_ms = 0.0; // part of step_ms
+		double merge_ms = 0.0;
+		double expire_ms = 0.0;
+		double sync_ms = 0.0;
+		std::vector<double> tick_us;
+	};
+
+	static const char* getSceneName(Scene scene)
+	{
+		switch (scene)
+		{
+		case UniformCloud: return "uniform_cloud";
+		case BinaryClusters: return "binary_clusters";
+		case MergeCascade: return "merge_cascade";
+		case MaxCapacity: return "max_capacity";
+		default: return "unknown";
+		}
+	}
+
+	GameWorldBenchmark(uint64_t seed, uint16_t max_players, uint16_t max_game_objects_per_player, float broadphase_rebuild_threshold, int solver_threads, float ccd_motion_ratio, bool add_players = true) :
+		m_app(max_players, max_game_objects_per_player, add_players),
+		m_random(seed),
+		m_world(&m_app)
+	{
+		m_world.setStepParameters(broadphase_rebuild_threshold, solver_threads, ccd_motion_ratio);
+	}
+
+	void seed(Scene scene)
+	{
+		int max_players = m_app.getPlayerManager()->getMaxPlayers();
+		int max_objects = m_app.getPlayerManager()->getMaxGameObjectsPerPlayer();
+
+		switch (scene)
+		{
+		case UniformCloud:
+			for (int i = 0; i < 200; ++i)
+			{
+				add(m_random(1, max_players - 1),
+					m_random(MIN_GAME_OBJECT_SIZE, MAX_GAME_OBJECT_CREATION_SIZE),
+					m_random(2.f, WORLD_WIDTH - 2.f), m_random(2.f, WORLD_HEIGHT - 2.f),
+					m_random(-2.f, 2.f), m_random(-2.f, 2.f));
+			}
+			break;
+
+		case BinaryClusters:
+			for (int pair = 0; pair < 3; ++pair)
+			{
+				float cx = WORLD_WIDTH * (pair + 1) / 4.f;
+				float cy = WORLD_HEIGHT / 2.f;
+
+				for (int side = 0; side < 2; ++side)
+				{
+					float dir = side ? 1.f : -1.f;
+					float ox = cx + dir * 4.f;
+
+					for (int i = 0; i < 30; ++i)
+					{
+						float angle = m_random(0.f, 6.2831853f);
+						float dist = m_random(0.f, 2.5f);
+						add(m_random(1, max_players - 1),
+							m_random(MIN_GAME_OBJECT_SIZE, 1.f),
+							ox + std::cos(angle) * dist, cy + std::sin(angle) * dist,
+							0.f, dir * 6.f);
+					}
+				}
+			}
+			break;
+
+		case MergeCascade:
+			// rings of objects falling straight into the center so they collide head-on
+			for (int ring = 0; ring < 4; ++ring)
+			{
+				float radius = 8.f + ring * 5.f;
+
+				for (int i = 0; i < 24; ++i)
+				{
+					float angle = (6.2831853f * i) / 24 + ring * 0.13f;
+					float speed = m_random(15.f, 25.f);
+					add(m_random(1, max_players - 1),
+						m_random(MIN_GAME_OBJECT_SIZE, 1.2f),
+						WORLD_WIDTH / 2.f + std::cos(angle) * radius, WORLD_HEIGHT / 2.f + std::sin(angle) * radius,
+						-std::cos(angle) * speed, -std::sin(angle) * speed);
+				}
+			}
+			break;
+
+		case MaxCapacity:
+			for (int player = 0; player < max_players; ++player)
+			{
+				for (int i = 0; i < max_objects; ++i)
+				{
+					add(player,
+						MIN_GAME_OBJECT_SIZE,
+						m_random(2.f, WORLD_WIDTH - 2.f), m_random(2.f, WORLD_HEIGHT - 2.f),
+						m_random(-1.f, 1.f), m_random(-1.f, 1.f));
+				}
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	Result run(unsigned ticks, InputLogReader* log = nullptr)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+
+		Result result;
+		result.bodies_start = countBodies();
+		result.tick_us.reserve(ticks);
+
+		for (unsigned tick = 0; tick < ticks || (log && !log->isEnd()); ++tick)
+		{
+			if (log)
+				m_world.replay(*log);
+
+			GameWorld::StepProfile profile;
+			auto t0 = Clock::now();
+			result.merges += m_world.step(&profile);
+			auto t1 = Clock::now();
+			m_world.syncRenderer();
+			auto t2 = Clock::now();
+
+			result.gravity_ms += profile.gravity_ms;
+			result.step_ms += profile.step_ms;
+			result.broadphase_ms += profile.broadphase_ms;
+			result.toi_ms += profile.toi_ms;
+			countEscapedBodies();
+			result.merge_ms += profile.merge_ms;
+			result.expire_ms += profile.expire_ms;
+			result.sync_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+			result.tick_us.push_back(std::chrono::duration<double, std::micro>(t2 - t0).count());
+		}
+
+		result.bodies_end = countBodies();
+		result.escaped = m_escaped.size();
+		return result;
+	}
+
+private:
+	BenchmarkApplication m_app;
+	raz::Random m_random;
+	GameWorld m_world;
+	std::set<const GameObject*> m_escaped;
+
+	void add(int player_id, float radius, float x, float y, float vx, float vy)
+	{
+		AddGameObject e;
+		e.player_id = (uint16_t)player_id;
+		e.radius = radius;
+		e.position_x = x;
+		e.position_y = y;
+		e.velocity_x = vx;
+		e.velocity_y = vy;
+		m_world.addGameObject(e);
+	}
+
+	void countEscapedBodies()
+	{
+		for (const b2Body* body = m_world.m_world.GetBodyList(); body != 0; body = body->GetNext())
+		{
+			const GameObject* obj = static_cast<const GameObject*>(body->GetUserData());
+			b2Vec2 p = body->GetPosition();
+
+			if (obj && (p.x < 0.f || p.x > WORLD_WIDTH || p.y < 0.f || p.y > WORLD_HEIGHT))
+				m_escaped.insert(obj);
+		}
+	}
+
+	size_t countBodies() const
+	{
+		size_t count = 0;
+		for (const b2Body* body = m_world.m_world.GetBodyList(); body != 0; body = body->GetNext())
+		{
+			if (body->GetUserData())
+				++count;
+		}
+		return count;
+	}
+};
+
+static double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0.0;
+
+	size_t n = (size_t)(p * (values.size() - 1) + 0.5);
+	std::nth_element(values.begin(), values.begin() + n, values.end());
+	return values[n];
+}
+
+static void printResult(const char* name, uint64_t seed, const GameWorldBenchmark::Result& result)
+{
+	std::printf("%s,%llu,%zu,%zu,%zu,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f\n",
+		name, (unsigned long long)seed, result.tick_us.size(),
+		result.bodies_start, result.bodies_end, result.merges, result.escaped,
+		result.gravity_ms, result.step_ms, result.broadphase_ms, result.toi_ms, result.merge_ms, result.expire_ms, result.sync_ms,
+		percentile(result.tick_us, 0.5), percentile(result.tick_us, 0.99));
+}
+
+static volatile float s_sink; // keeps the micro benchmark results alive
+
+// Packet throughput of a full GameObjectSync, the bulk of the network traffic.
+static void benchmarkSerializer()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	typedef raz::Packet<MAX_PACKET_SIZE> Packet;
+
+	GameObjectSync sync;
+	sync.sync_id = 1;
+	sync.object_count = MAX_GAME_OBJECTS_PER_SYNC;
+	for (uint32_t i = 0; i < sync.object_count; ++i)
+		sync.object_states[i] = { (uint16_t)(i % 4), (uint16_t)i, 0.5f + 0.1f * i, 10.f * i, 20.f - i, 0.25f * i, -3.f * i };
+
+	const int runs = 200000;
+	Packet packet;
+
+	auto t0 = Clock::now();
+	for (int run = 0; run < runs; ++run)
+	{
+		packet.reset();
+		packet.setMode(raz::SerializationMode::SERIALIZE);
+		packet(sync);
+	}
+	auto t1 = Clock::now();
+
+	uint32_t size = packet.getPacketData()->head.packet_size;
+	GameObjectSync result;
+
+	auto t2 = Clock::now();
+	for (int run = 0; run < runs; ++run)
+	{
+		packet.reset();
+		packet.getPacketData()->head.packet_size = size;
+		packet.setMode(raz::SerializationMode::DESERIALIZE);
+		packet(result);
+	}
+	auto t3 = Clock::now();
+
+	s_sink = result.object_states[MAX_GAME_OBJECTS_PER_SYNC - 1].velocity_y;
+
+	double bytes = (double)size * runs;
+	std::printf("GameObjectSync,%u,%.1f,%.1f\n", size,
+		bytes / std::chrono::duration<double, std::micro>(t1 - t0).count(),
+		bytes / std::chrono::duration<double, std::micro>(t3 - t2).count());
+}
+
+// Nanoseconds per full pass over a Bitset with 70% of the bits set, like a busy memory pool.
+template<size_t N>
+static void benchmarkBitset(raz::Random& random)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	raz::Bitset<N> bitset;
+	for (size_t i = 0; i < N; ++i)
+	{
+		if (random(0, 99) < 70)
+			bitset.set(i);
+	}
+
+	// read through a volatile pointer, so the passes cannot be merged
+	raz::Bitset<N>* volatile bitset_ptr = &bitset;
+	const int passes = 4000000 / (int)N + 1000;
+	size_t sink = 0;
+
+	auto t0 = Clock::now();
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		for (size_t bit : bitset_ptr->truebits())
+			sink += bit;
+	}
+	auto t1 = Clock::now();
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		for (size_t bit : bitset_ptr->falsebits())
+			sink += bit;
+	}
+	auto t2 = Clock::now();
+	for (int pass = 0; pass < passes; ++pass)
+		sink += bitset_ptr->truebits().count();
+	auto t3 = Clock::now();
+	for (int pass = 0; pass < passes; ++pass)
+		sink += bitset_ptr->findFalseBits(3);
+	auto t4 = Clock::now();
+
+	s_sink = (float)sink;
+
+	auto ns = [passes](Clock::time_point begin, Clock::time_point end)
+	{
+		return std::chrono::duration<double, std::nano>(end - begin).count() / passes;
+	};
+
+	std::printf("%zu,%.1f,%.1f,%.1f,%.1f\n", N, ns(t0, t1), ns(t1, t2), ns(t2, t3), ns(t3, t4));
+}
+
+int main(int argc, char** argv)
+{
+	unsigned ticks = (argc > 1) ? (unsigned)std::stoul(argv[1]) : 600;
+	uint64_t seed = (argc > 2) ? std::stoull(argv[2]) : 1;
+	const char* scene_filter = (argc > 3 && std::strcmp(argv[3], "all") != 0) ? argv[3] : nullptr;
+	uint16_t max_players = (argc > 4) ? (uint16_t)std::stoul(argv[4]) : DEFAULT_MAX_PLAYERS;
+	uint16_t max_objects = (argc > 5) ? (uint16_t)std::stoul(argv[5]) : DEFAULT_MAX_GAME_OBJECTS_PER_PLAYER;
+	float rebuild_threshold = (argc > 6) ? std::stof(argv[6]) : WORLD_BROADPHASE_REBUILD_THRESHOLD;
+	int solver_threads = (argc > 7) ? std::stoi(argv[7]) : WORLD_SOLVER_THREADS;
+	g_batchSolve = (argc > 8) ? (std::stoi(argv[8]) != 0) : true;
+	float ccd_motion_ratio = (argc > 9) ? std::stof(argv[9]) : WORLD_CCD_MOTION_RATIO;
+
+	if (scene_filter && std::strcmp(scene_filter, "serializer") == 0)
+	{
+		std::printf("event,bytes,serialize_bytes_per_us,deserialize_bytes_per_us\n");
+		benchmarkSerializer();
+		return 0;
+	}
+
+	if (scene_filter && std::strcmp(scene_filter, "bitset") == 0)
+	{
+		raz::Random random(seed);
+		std::printf("bits,truebits_ns,falsebits_ns,count_ns,find_false_bits_ns\n");
+		benchmarkBitset<32>(random);
+		benchmarkBitset<416>(random);
+		benchmarkBitset<4096>(random);
+		return 0;
+	}
+
+	std::printf("scene,seed,ticks,bodies_start,bodies_end,merges,escaped,gravity_ms,step_ms,broadphase_ms,toi_ms,merge_ms,expire_ms,sync_ms,tick_p50_us,tick_p99_us\n");
+
+	if (scene_filter && std::strncmp(scene_filter, "replay:", 7) == 0)
+	{
+		try
+		{
+			InputLogReader log(scene_filter + 7);
+			GameWorldBenchmark benchmark(seed, log.getMaxPlayers(), log.getMaxGameObjectsPerPlayer(), rebuild_threshold, solver_threads, ccd_motion_ratio, false);
+			printResult("replay", seed, benchmark.run(ticks, &log));
+		}
+		catch (std::exception&)
+		{
+			std::fprintf(stderr, "Cannot replay %s\n", scene_filter + 7);
+			return -1;
+		}
+
+		return 0;
+	}
+
+	for (int i = 0; i < GameWorldBenchmark::SceneCount; ++i)
+	{
+		auto scene = static_cast<GameWorldBenchmark::Scene>(i);
+		const char* name = GameWorldBenchmark::getSceneName(scene);
+
+		if (scene_filter && std::strcmp(scene_filter, name) != 0)
+			continue;
+
+		GameWorldBenchmark benchmark(seed, max_players, max_objects, rebuild_threshold, solver_threads, ccd_motion_ratio);
+		benchmark.seed(scene);
+		printResult(name, seed, benchmark.run(ticks));
+	}
+
+	return 0;
+}
@@ -18,12 +18,18 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #include "common/Application.hpp"
 #include "common/Config.hpp"
+#include "common/Profiler.hpp"
 #include <codecvt>
+#include <cstdlib>
+#include <cstring>
 #include <Windows.h>
 
 static_assert(MAX_PACKET_SIZE >= sizeof(GameObjectSync), "MAX_PACKET_SIZE is too low");
+static_assert(MAX_PACKET_SIZE >= 1 + 5 + MAX_HIGHSCORE_ENTRIES_PER_SYNC * (3 + 5), "MAX_HIGHSCORE_ENTRIES_PER_SYNC is too high"); // flags + varint count + varint entries
+static_assert(MAX_PACKET_SIZE >= 3 + 5 + 4 * MAX_MESSAGE_LENGTH, "MAX_MESSAGE_LENGTH is too high"); // varint player_id + varint length + UTF-8
 static_assert(PING_RATE < CONNECTION_TIMEOUT, "PING_RATE should be lower than CONNECTION_TIMEOUT");
 static_assert(GAME_SYNC_RATE < CONNECTION_TIMEOUT, "GAME_SYNC_RATE should be lower than CONNECTION_TIMEOUT");
+static_assert(HIGHSCORE_SYNC_RATE < HIGHSCORE_FULL_SYNC_RATE, "HIGHSCORE_SYNC_RATE should be lower than HIGHSCORE_FULL_SYNC_RATE");
 
 int Application::run(int argc, char** argv)
 {
@@ -31,7 +37,9 @@ int Application::run(int argc, char** argv)
 }
 
 Application::Application(int argc, char** argv) :
-	m_mode(GameMode::SingplePlay)
+	m_mode(GameMode::SingplePlay),
+	m_max_players(DEFAULT_MAX_PLAYERS),
+	m_max_game_objects_per_player(DEFAULT_MAX_GAME_OBJECTS_PER_PLAYER)
 {
 	if (argc > 1)
 	{
@@ -84,6 +92,10 @@ void Application::setGameMode(GameMode mode)
 
 	m_player_mgr.reset();
 
+	// clients get the capacity of the server in the Connected event
+	if (mode != GameMode::Client)
+		m_player_mgr.setCapacity(m_max_players, m_max_game_objects_per_player);
+
 	switch (mode)
 	{
 	case GameMode::SingplePlay:
@@ -137,6 +149,58 @@ bool Application::handleCommand(const std::string& cmd)
 		std::thread(&Application::setGameMode, this, GameMode::Client).detach();
 		return true;
 	}
+	else if (cmd.compare(0, 10, "/capacity ") == 0 && cmd.size() > 10)
+	{
+		// applies to the next /single or /host session, a malformed one is ignored
+		const char* str = &cmd[10];
+		char* end;
+		unsigned long max_players = std::strtoul(str, &end, 10);
+		unsigned long max_objects = m_max_game_objects_per_player;
+		bool valid = (end != str);
+
+		if (valid && *end != '\0')
+		{
+			str = end;
+			max_objects = std::strtoul(str, &end, 10);
+			valid = (end != str && *end == '\0');
+		}
+
+		if (valid && max_players >= 2 && max_players <= UINT16_MAX && max_objects >= 1 && max_objects <= UINT16_MAX)
+		{
+			m_max_players = (uint16_t)max_players;
+			m_max_game_objects_per_player = (uint16_t)max_objects;
+		}
+		return true;
+	}
+	else if (m_mode == GameMode::Host && cmd.compare("/netstats") == 0)
+	{
+		m_network_server(NetworkStatsRequest());
+		return true;
+	}
+	else if (m_mode != GameMode::Client && (cmd.compare("/save") == 0 || cmd.compare(0, 6, "/save ") == 0))
+	{
+		SaveSnapshot e;
+		e.filename = (cmd.size() > 6) ? &cmd[6] : SNAPSHOT_FILE;
+		m_world(std::move(e));
+		return true;
+	}
+	else if (m_mode != GameMode::Client && (cmd.compare("/load") == 0 || cmd.compare(0, 6, "/load ") == 0))
+	{
+		LoadSnapshot e;
+		e.filename = (cmd.size() > 6) ? &cmd[6] : SNAPSHOT_FILE;
+		m_world(std::move(e));
+		return true;
+	}
+	else if (cmd.compare("/profile") == 0)
+	{
+		const char* msg = Profiler::exportTrace(PROFILER_TRACE_FILE) ? "Profile saved to " PROFILER_TRACE_FILE : "Cannot save the profile to " PROFILER_TRACE_FILE;
+
+		Message e;
+		e.player_id = 0;
+		e.message.assign(msg, msg + std::strlen(msg));
+		m_window(std::move(e));
+		return true;
+	}
 	else if (cmd.compare(0, 8, "/player ") == 0 && cmd.size() > 8)
 	{
 		SwitchPlayer e;
@@ -175,17 +239,23 @@ void Application::exit(int code, const char* msg)
 	m_exit.set_value({ code, msg ? msg : "" });
 }
 
-void Application::handle(const Connected& e, EventSource src)
+void Application::handle(Connected e, EventSource src)
 {
 	if (m_mode == GameMode::Client)
 	{
+		m_player_mgr.setCapacity(e.max_players, e.max_game_objects_per_player);
+
 		const Player* player = m_player_mgr.addLocalPlayer(e.player_id);
 		if (player)
 			m_window.start(this, player);
 	}
+	else
+	{
+		route(std::move(e), src);
+	}
 }
 
-void Application::handle(const Disconnected& e, EventSource src)
+void Application::handle(Disconnected e, EventSource src)
 {
 	if (m_mode == GameMode::Client)
 	{
@@ -210,143 +280,78 @@ void Application::handle(const Disconnected& e, EventSource src)
 	}
 }
 
-void Application::handle(const SwitchPlayer& e, EventSource src)
+void Application::handle(SwitchPlayer e, EventSource src)
 {
-	if (src == EventSource::GameWindow) // command
-	{
-		if (m_mode == GameMode::Client)
-		{
-			m_network_client(e);
-		}
-		else if (m_player_mgr.switchPlayer(e.player_id, e.new_player_id))
-		{
-			m_window(e);
-			m_world(e);
+	unsigned targets = EventRoute<SwitchPlayer>::getTargets(src, m_mode);
+	if (!targets)
+		return;
 
-			if (m_mode == GameMode::Host)
-				m_network_server(e);
-		}
-	}
-	else if (src == EventSource::Network)
-	{
-		if (m_player_mgr.switchPlayer(e.player_id, e.new_player_id))
-		{
-			if (m_mode == GameMode::Host)
-			{
-				m_world(e);
-				m_network_server(e);
-			}
-			else if (m_mode == GameMode::Client)
-			{
-				m_window(e);
-			}
-		}
-	}
+	// clients only forward the command, the server does the switch
+	if (targets != ToNetworkClient && !m_player_mgr.switchPlayer(e.player_id, e.new_player_id))
+		return;
+
+	route(std::move(e), targets);
 }
 
-void Application::handle(const Message& e, EventSource src)
+void Application::handle(Message e, EventSource src)
 {
-
-	if (src == EventSource::GameWindow)
-	{
-		bool is_command = false;
-
-		if (e.message[0] == (uint32_t)'/')
-		{
-			using convert_type = std::codecvt_utf8<uint32_t>;
-			std::wstring_convert<convert_type, uint32_t> converter;
-			is_command = handleCommand(converter.to_bytes(e.message));
-		}
-
-		if (!is_command)
-		{
-			m_window(e);
-
-			if (m_mode == GameMode::Host)
-				m_network_server(e);
-			else if (m_mode == GameMode::Client)
-				m_network_client(e);
-		}
-	}
-	else
+	if (src == EventSource::GameWindow && e.message[0] == (uint32_t)'/')
 	{
-		m_window(e);
+		using convert_type = std::codecvt_utf8<uint32_t>;
+		std::wstring_convert<convert_type, uint32_t> converter;
+		if (handleCommand(converter.to_bytes(e.message)))
+			return;
 	}
+
+	route(std::move(e), src);
 }
 
-void Application::handle(const AddGameObject& e, EventSource src)
+void Application::handle(AddGameObject e, EventSource src)
 {
-	if (m_mode == GameMode::Client)
-	{
-		m_network_client(e);
-	}
-	else
-	{
-		m_world(e);
-	}
+	route(std::move(e), src);
 }
 
-void Application::handle(const MergeGameObjects& e, EventSource src)
+void Application::handle(RemoveGameObjectsNearMouse e, EventSource src)
 {
-	if (m_mode != GameMode::Client)
-		m_world(e);
+	route(std::move(e), src);
 }
 
-void Application::handle(const RemoveGameObjectsNearMouse& e, EventSource src)
+void Application::handle(RemoveGameObject e, EventSource src)
 {
-	m_world(e);
+	route(std::move(e), src);
 }
 
-void Application::handle(const RemoveGameObject& e, EventSource src)
+void Application::handle(RemovePlayerGameObjects e, EventSource src)
 {
-	if (m_mode == GameMode::Client)
-	{
-		m_network_client(e);
-	}
-	else
-	{
-		m_world(e);
-	}
+	route(std::move(e), src);
 }
 
-void Application::handle(const RemovePlayerGameObjects& e, EventSource src)
+void Application::handle(GameObjectSync e, EventSource src)
 {
-	if (m_mode == GameMode::Host)
-	{
-		m_world(e);
-	}
+	unsigned targets = getTargets(e, src);
+	route(std::move(e), targets);
 }
 
-void Application::handle(const GameObjectSync& e, EventSource src)
+void Application::handle(const std::vector<GameObjectSync>& batch, EventSource src)
 {
-	if (e.target == GameObjectSync::Target::GameWindow)
-	{
-		m_window(e);
-	}
-	else if (m_mode == GameMode::Client)
-	{
-		m_world(e);
-	}
-	else
-	{
-		m_network_server(e);
-	}
+	if (!batch.empty())
+		routeBatch(batch, getTargets(batch.front(), src));
 }
 
-void Application::handle(const GameObjectSyncRequest& e, EventSource src)
+void Application::handle(GameObjectSyncRequest e, EventSource src)
 {
-	if (m_mode == GameMode::Host)
-	{
-		m_world(e);
-	}
+	route(std::move(e), src);
 }
 
-void Application::handle(const Highscore& e, EventSource src)
+void Application::handle(Highscore e, EventSource src)
 {
-	m_window(e);
+	route(std::move(e), src);
+}
 
-	if (m_mode == GameMode::Host)
-	{
-		m_network_server(e);
-	}
+unsigned Application::getTargets(const GameObjectSync& e, EventSource src) const
+{
+	if (e.target == GameObjectSync::Target::GameWindow)
+		return ToGameWindow;
+	else
+		return EventRoute<GameObjectSync>::getTargets(src, m_mode);
 }
@@ -20,11 +20,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #include <future>
 #include <string>
+#include <type_traits>
+#include <vector>
 #include <raz/thread.hpp>
 #include "gamewindow/GameWindow.hpp"
 #include "gameworld/GameWorld.hpp"
 #include "network/NetworkClient.hpp"
 #include "network/NetworkServer.hpp"
+#include "common/EventRoutes.hpp"
 #include "common/PlayerManager.hpp"
 #include "common/IApplication.hpp"
 
@@ -37,18 +40,18 @@ public:
 	virtual GameMode getGameMode() const;
 	virtual PlayerManager* getPlayerManager();
 	virtual void exit(int exit_code, const char* msg = nullptr);
-	virtual void handle(const Connected& e, EventSource src);
-	virtual void handle(const Disconnected& e, EventSource src);
-	virtual void handle(const SwitchPlayer& e, EventSource src);
-	virtual void handle(const Message& e, EventSource src);
-	virtual void handle(const AddGameObject& e, EventSource src);
-	virtual void handle(const MergeGameObjects& e, EventSource src);
-	virtual void handle(const RemoveGameObjectsNearMouse& e, EventSource src);
-	virtual void handle(const RemoveGameObject& e, EventSource src);
-	virtual void handle(const RemovePlayerGameObjects& e, EventSource src);
-	virtual void handle(const GameObjectSync& e, EventSource src);
-	virtual void handle(const GameObjectSyncRequest& e, EventSource src);
-	virtual void handle(const Highscore& e, EventSource src);
+	virtual void handle(Connected e, EventSource src);
+	virtual void handle(Disconnected e, EventSource src);
+	virtual void handle(SwitchPlayer e, EventSource src);
+	virtual void handle(Message e, EventSource src);
+	virtual void handle(AddGameObject e, EventSource src);
+	virtual void handle(RemoveGameObjectsNearMouse e, EventSource src);
+	virtual void handle(RemoveGameObject e, EventSource src);
+	virtual void handle(RemovePlayerGameObjects e, EventSource src);
+	virtual void handle(GameObjectSync e, EventSource src);
+	virtual void handle(const std::vector<GameObjectSync>& batch, EventSource src);
+	virtual void handle(GameObjectSyncRequest e, EventSource src);
+	virtual void handle(Highscore e, EventSource src);
 
 private:
 	struct ExitInfo
@@ -61,9 +64,74 @@ private:
 	int run();
 	void setGameMode(GameMode mode);
 	bool handleCommand(const std::string& cmd);
+	unsigned getTargets(const GameObjectSync& e, EventSource src) const;
+
+	// threads outside the route of an event don't get the post instantiated at all
+	template<class Event, EventTarget Target>
+	using isConsumer = std::integral_constant<bool, (EventRoute<Event>::consumers & Target) != 0>;
+
+	template<class Event>
+	void route(Event&& e, EventSource src)
+	{
+		route(std::move(e), EventRoute<Event>::getTargets(src, m_mode));
+	}
+
+	// every target but the last one gets a copy, the last one gets the event moved into its queue
+	template<class Event>
+	void route(Event&& e, unsigned targets)
+	{
+		static_assert(!std::is_lvalue_reference<Event>::value, "Events are moved to their last target");
+
+		post(m_window, e, targets, ToGameWindow, isConsumer<Event, ToGameWindow>());
+		post(m_world, e, targets, ToGameWorld, isConsumer<Event, ToGameWorld>());
+		post(m_network_client, e, targets, ToNetworkClient, isConsumer<Event, ToNetworkClient>());
+		post(m_network_server, e, targets, ToNetworkServer, isConsumer<Event, ToNetworkServer>());
+	}
+
+	template<class Event>
+	void routeBatch(const std::vector<Event>& batch, unsigned targets)
+	{
+		postBatch(m_window, batch, targets, ToGameWindow, isConsumer<Event, ToGameWindow>());
+		postBatch(m_world, batch, targets, ToGameWorld, isConsumer<Event, ToGameWorld>());
+		postBatch(m_network_client, batch, targets, ToNetworkClient, isConsumer<Event, ToNetworkClient>());
+		postBatch(m_network_server, batch, targets, ToNetworkServer, isConsumer<Event, ToNetworkServer>());
+	}
+
+	template<class T, class Event>
+	static void post(raz::Thread<T>& thread, Event& e, unsigned& targets, EventTarget target, std::true_type)
+	{
+		if (targets & target)
+		{
+			targets &= ~target;
+
+			if (targets)
+				thread(static_cast<const Event&>(e));
+			else
+				thread(std::move(e));
+		}
+	}
+
+	template<class T, class Event>
+	static void post(raz::Thread<T>&, Event&, unsigned&, EventTarget, std::false_type)
+	{
+	}
+
+	template<class T, class Event>
+	static void postBatch(raz::Thread<T>& thread, const std::vector<Event>& batch, unsigned targets, EventTarget target, std::true_type)
+	{
+		if (targets & target)
+			thread.batch(batch.begin(), batch.end());
+	}
+
+	template<class T, class Event>
+	static void postBatch(raz::Thread<T>&, const std::vector<Event>&, unsigned, EventTarget, std::false_type)
+	{
+	}
 
 	GameMode m_mode;
 	PlayerManager m_player_mgr;
+	uint16_t m_max_players;
+	uint16_t m_max_game_objects_per_player;
 	std::string m_cmdline;
 	std::promise<ExitInfo> m_exit;
 	raz::Thread<GameWindow> m_window;
@@ -25,6 +25,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #define ANTIALIASING_LEVEL 4
 #define MESSAGE_TIMEOUT 3000
 #define MESSAGE_CHAR_SIZE 16
+#define MAX_MESSAGE_LENGTH 120 // code points, sent as UTF-8
 #define MOUSE_IDLE_TIMEOUT 3000
 
 // world config
@@ -32,10 +33,16 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #define WORLD_HEIGHT 60
 #define WORLD_SCALE (1.f / 10.f)
 #define WORLD_STEP (1.f / 60.f)
+#define WORLD_TICKS(ms) ((uint64_t)((ms) / (1000.f * WORLD_STEP) + 0.5f)) // gameplay time is counted in fixed steps
+#define WORLD_VELOCITY_ITERATIONS 8
+#define WORLD_POSITION_ITERATIONS 3
+#define WORLD_BROADPHASE_REBUILD_THRESHOLD 0.f // rebuild the broad-phase tree if this fraction of bodies moved, 0 = incremental updates
+#define WORLD_SOLVER_THREADS 1 // threads solving independent islands, 1 = solve on the world thread only
+#define WORLD_RESERVED_CONTACTS_PER_GAME_OBJECT 4 // contacts allocated up front for each game object of the capacity
+#define WORLD_CCD_MOTION_RATIO 0.5f // bodies moving more than this fraction of (radius + MIN_GAME_OBJECT_SIZE) per step use continuous collision, 0 = all bodies
 #define GRAVITY 1800.f
-#define MAX_PLAYERS 13 // player0 + player1..12
-#define MAX_GAME_OBJECTS_PER_PLAYER 32
-#define MAX_GAME_OBJECTS (MAX_PLAYERS * MAX_GAME_OBJECTS_PER_PLAYER)
+#define DEFAULT_MAX_PLAYERS 13 // player0 + player1..12, see /capacity
+#define DEFAULT_MAX_GAME_OBJECTS_PER_PLAYER 32
 
 // gameplay config
 #define MIN_GAME_OBJECT_SIZE 0.4f
@@ -49,12 +56,42 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #define GAME_OBJECT_MERGE_SCALE_THRESHOLD 1.2f
 #define GAME_OBJECT_MERGE_BONUS 5
 #define GAME_OBJECT_EXPIRATION_BONUS 5
-#define HIGHSCORE_SYNC_RATE 500
+#define HIGHSCORE_SYNC_RATE 100 // changed scores are sent at most this often
+#define HIGHSCORE_FULL_SYNC_RATE 5000 // the whole highscore is resent this often in case an update got lost
+
+// snapshot config
+#define SNAPSHOT_FILE "razzgravitas.snapshot" // default of /save and /load
+#define SNAPSHOT_RATE 0 // a host checkpoints the world to SNAPSHOT_FILE this often and resumes from it when started, 0 = never
+#define INPUT_LOG 0 // a host records the inbound events of its session to INPUT_LOG_FILE for replays, 0 = off
+#define INPUT_LOG_FILE "razzgravitas.inputlog" // see razzgravitas-benchmark
+#define INPUT_LOG_MAX_SIZE (64 * 1024 * 1024) // a full log is kept as INPUT_LOG_FILE ".1" and a new one is started
+
+// profiler config
+#define PROFILER 1 // scoped timing zones, F3 toggles their overlay, 0 = compiled out
+#define PROFILER_BUFFER_SIZE 4096 // samples kept per thread, power of 2
+#define PROFILER_TRACE_FILE "razzgravitas.trace.json" // written by /profile
+#define PROFILER_OVERLAY_SAMPLES 256 // the overlay shows p50/p99 of this many recent samples per zone
+#define PROFILER_OVERLAY_RATE 500 // ms between overlay updates
 
 // network config
 #define GAME_PORT 12345
 #define MAX_PACKET_SIZE 512
 #define MAX_GAME_OBJECTS_PER_SYNC 16
+#define MAX_HIGHSCORE_ENTRIES_PER_SYNC 48
 #define GAME_SYNC_RATE 50
 #define PING_RATE 250
 #define CONNECTION_TIMEOUT 3000
+#define SEND_QUEUE_SIZE 1024 // outgoing packets waiting for the sender thread, power of 2
+#define SEND_PACING_WINDOW 20 // a burst of packets is spread over this many ms
+#define SEND_PACING_SLICE 1
+#define CHALLENGE_TIMEOUT 5000 // a handshake cookie is accepted this long after it was issued
+
+// inbound action limits per client (actions per second, burst size)
+#define ADD_GAME_OBJECT_RATE_LIMIT 20
+#define ADD_GAME_OBJECT_BURST_LIMIT 20
+#define REMOVE_GAME_OBJECT_RATE_LIMIT 32
+#define REMOVE_GAME_OBJECT_BURST_LIMIT 64 // raised to the object capacity, a right click can remove all of them
+#define MESSAGE_RATE_LIMIT 2
+#define MESSAGE_BURST_LIMIT 5
+#define SWITCH_PLAYER_RATE_LIMIT 1
+#define SWITCH_PLAYER_BURST_LIMIT 3
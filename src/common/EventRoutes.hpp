@@ -0,0 +1,160 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#pragma once
+
+#include "common/Events.hpp"
+#include "common/IApplication.hpp"
+
+enum EventTarget : unsigned
+{
+	NoTarget        = 0,
+	ToGameWindow    = (1 << 0),
+	ToGameWorld     = (1 << 1),
+	ToNetworkClient = (1 << 2),
+	ToNetworkServer = (1 << 3)
+};
+
+constexpr unsigned combineEventTargets()
+{
+	return NoTarget;
+}
+
+template<class... Rest>
+constexpr unsigned combineEventTargets(unsigned targets, Rest... rest)
+{
+	return targets | combineEventTargets(rest...);
+}
+
+/*
+A routing table has a row for each EventSource and a column for each GameMode. The
+table is a compile-time constant, so Application only instantiates the posts to the
+threads an event can ever reach (consumers) and looks up the rest by index.
+*/
+template<unsigned... Targets>
+struct EventRouteTable
+{
+	static constexpr int SOURCE_COUNT = 3; // EventSource
+	static constexpr int MODE_COUNT = 3; // GameMode
+	static constexpr unsigned consumers = combineEventTargets(Targets...);
+
+	static_assert(sizeof...(Targets) == SOURCE_COUNT * MODE_COUNT, "Wrong routing table size");
+
+	static unsigned getTargets(EventSource src, GameMode mode)
+	{
+		static constexpr unsigned targets[] = { Targets... };
+		return targets[(int)src * MODE_COUNT + (int)mode];
+	}
+};
+
+// events without a route (Disconnected) are only consumed by Application
+template<class Event>
+struct EventRoute;
+
+// clients handle their own Connected in Application, the world of a host records the joins
+template<>
+struct EventRoute<Connected> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	NoTarget,                     NoTarget,                                        NoTarget,          // GameWindow
+	NoTarget,                     NoTarget,                                        NoTarget,          // GameWorld
+	NoTarget,                     ToGameWorld,                                     NoTarget>          // Network
+{
+};
+
+template<>
+struct EventRoute<SwitchPlayer> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	ToGameWindow | ToGameWorld,   ToGameWindow | ToGameWorld | ToNetworkServer,    ToNetworkClient,   // GameWindow
+	NoTarget,                     NoTarget,                                        NoTarget,          // GameWorld
+	NoTarget,                     ToGameWorld | ToNetworkServer,                   ToGameWindow>      // Network
+{
+};
+
+template<>
+struct EventRoute<Message> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	ToGameWindow,                 ToGameWindow | ToNetworkServer,                  ToGameWindow | ToNetworkClient,  // GameWindow
+	ToGameWindow,                 ToGameWindow,                                    ToGameWindow,                    // GameWorld
+	ToGameWindow,                 ToGameWindow,                                    ToGameWindow>                    // Network
+{
+};
+
+template<>
+struct EventRoute<AddGameObject> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	ToGameWorld,                  ToGameWorld,                                     ToNetworkClient,   // GameWindow
+	ToGameWorld,                  ToGameWorld,                                     ToNetworkClient,   // GameWorld
+	ToGameWorld,                  ToGameWorld,                                     ToNetworkClient>   // Network
+{
+};
+
+template<>
+struct EventRoute<RemoveGameObjectsNearMouse> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	ToGameWorld,                  ToGameWorld,                                     ToGameWorld,       // GameWindow
+	ToGameWorld,                  ToGameWorld,                                     ToGameWorld,       // GameWorld
+	ToGameWorld,                  ToGameWorld,                                     ToGameWorld>       // Network
+{
+};
+
+template<>
+struct EventRoute<RemoveGameObject> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	ToGameWorld,                  ToGameWorld,                                     ToNetworkClient,   // GameWindow
+	ToGameWorld,                  ToGameWorld,                                     ToNetworkClient,   // GameWorld
+	ToGameWorld,                  ToGameWorld,                                     ToNetworkClient>   // Network
+{
+};
+
+template<>
+struct EventRoute<RemovePlayerGameObjects> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	NoTarget,                     ToGameWorld,                                     NoTarget,          // GameWindow
+	NoTarget,                     ToGameWorld,                                     NoTarget,          // GameWorld
+	NoTarget,                     ToGameWorld,                                     NoTarget>          // Network
+{
+};
+
+// syncs with GameObjectSync::Target::GameWindow skip the table and go to the window
+template<>
+struct EventRoute<GameObjectSync> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	ToNetworkServer,              ToNetworkServer,                                 ToGameWorld,       // GameWindow
+	ToNetworkServer,              ToNetworkServer,                                 ToGameWorld,       // GameWorld
+	ToNetworkServer,              ToNetworkServer,                                 ToGameWorld>       // Network
+{
+	static constexpr unsigned consumers = ToGameWindow | ToGameWorld | ToNetworkServer;
+};
+
+template<>
+struct EventRoute<GameObjectSyncRequest> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	NoTarget,                     ToGameWorld,                                     NoTarget,          // GameWindow
+	NoTarget,                     ToGameWorld,                                     NoTarget,          // GameWorld
+	NoTarget,                     ToGameWorld,                                     NoTarget>          // Network
+{
+};
+
+template<>
+struct EventRoute<Highscore> : public EventRouteTable<
+	// SingplePlay                Host                                             Client
+	ToGameWindow,                 ToGameWindow | ToNetworkServer,                  ToGameWindow,      // GameWindow
+	ToGameWindow,                 ToGameWindow | ToNetworkServer,                  ToGameWindow,      // GameWorld
+	ToGameWindow,                 ToGameWindow | ToNetworkServer,                  ToGameWindow>      // Network
+{
+};
@@ -20,7 +20,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <raz/hash.hpp>
+#include <raz/serialization.hpp>
 #include "common/Config.hpp"
 #include "common/GameObjectState.hpp"
 
@@ -28,6 +30,7 @@ enum class EventType : uint32_t
 {
 	Unknown,
 	Hello             = (uint32_t)raz::hash("Hello"),
+	Challenge         = (uint32_t)raz::hash("Challenge"),
 	Ping              = (uint32_t)raz::hash("Ping"),
 	Connected         = (uint32_t)raz::hash("Connected"),
 	Disconnected      = (uint32_t)raz::hash("Disconnected"),
@@ -58,6 +61,8 @@ struct Event
 struct Hello : public Event<EventType::Hello>
 {
 	uint64_t build_hash;
+	uint64_t cookie = 0; // echoed from Challenge, 0 in the first Hello
+	uint32_t cookie_time = 0;
 
 	static constexpr uint64_t unique_build_hash()
 	{
@@ -67,7 +72,19 @@ struct Hello : public Event<EventType::Hello>
 	template<class Serializer>
 	void operator()(Serializer& serializer)
 	{
-		serializer(build_hash);
+		serializer(build_hash)(cookie)(cookie_time);
+	}
+};
+
+struct Challenge : public Event<EventType::Challenge>
+{
+	uint64_t cookie;
+	uint32_t cookie_time;
+
+	template<class Serializer>
+	void operator()(Serializer& serializer)
+	{
+		serializer(cookie)(cookie_time);
 	}
 };
 
@@ -78,11 +95,13 @@ struct Ping : public Event<EventType::Ping>
 struct Connected : public Event<EventType::Connected>
 {
 	uint16_t player_id;
+	uint16_t max_players;
+	uint16_t max_game_objects_per_player;
 
 	template<class Serializer>
 	void operator()(Serializer& serializer)
 	{
-		serializer(player_id);
+		serializer(raz::varint(player_id))(raz::varint(max_players))(raz::varint(max_game_objects_per_player));
 	}
 };
 
@@ -101,7 +120,7 @@ struct Disconnected : public Event<EventType::Disconnected>
 	void operator()(Serializer& serializer)
 	{
 		int& _reason = *(int*)(&reason);
-		serializer(_reason);
+		serializer(raz::varint(_reason));
 	}
 };
 
@@ -113,19 +132,19 @@ struct SwitchPlayer : public Event<EventType::SwitchPlayer>
 	template<class Serializer>
 	void operator()(Serializer& serializer)
 	{
-		serializer(player_id)(new_player_id);
+		serializer(raz::varint(player_id))(raz::varint(new_player_id));
 	}
 };
 
 struct Message : public Event<EventType::Message>
 {
 	uint16_t player_id;
-	std::basic_string<uint32_t, std::char_traits<uint32_t>, std::allocator<uint32_t>> message;
+	std::basic_string<uint32_t, std::char_traits<uint32_t>, std::allocator<uint32_t>> message; // at most MAX_MESSAGE_LENGTH when sent
 
 	template<class Serializer>
 	void operator()(Serializer& serializer)
 	{
-		serializer(player_id)(message);
+		serializer(raz::varint(player_id))(raz::utf8(message, MAX_MESSAGE_LENGTH));
 	}
 };
 
@@ -141,16 +160,10 @@ struct AddGameObject : public Event<EventType::AddGameObject>
 	template<class Serializer>
 	void operator()(Serializer& serializer)
 	{
-		serializer(radius)(position_x)(position_y)(velocity_x)(velocity_y)(player_id);
+		serializer(radius)(position_x)(position_y)(velocity_x)(velocity_y)(raz::varint(player_id));
 	}
 };
 
-struct MergeGameObjects : public Event<>
-{
-	uint16_t player_id[2];
-	uint16_t object_id[2];
-};
-
 struct RemoveGameObject : public Event<EventType::RemoveGameObject>
 {
 	uint16_t player_id;
@@ -159,7 +172,7 @@ struct RemoveGameObject : public Event<EventType::RemoveGameObject>
 	template<class Serializer>
 	void operator()(Serializer& serializer)
 	{
-		serializer(player_id)(object_id);
+		serializer(raz::varint(player_id))(raz::varint(object_id));
 	}
 };
 
@@ -169,11 +182,23 @@ struct RemoveGameObjectsNearMouse : public Event<>
 	float position_y;
 	float radius;
 	uint16_t player_id;
+
+	template<class Serializer>
+	void operator()(Serializer& serializer)
+	{
+		serializer(position_x)(position_y)(radius)(raz::varint(player_id));
+	}
 };
 
 struct RemovePlayerGameObjects : public Event<>
 {
 	uint16_t player_id;
+
+	template<class Serializer>
+	void operator()(Serializer& serializer)
+	{
+		serializer(raz::varint(player_id));
+	}
 };
 
 struct GameObjectSyncRequest : public Event<>
@@ -181,6 +206,20 @@ struct GameObjectSyncRequest : public Event<>
 	uint32_t sync_id;
 };
 
+struct NetworkStatsRequest : public Event<>
+{
+};
+
+struct SaveSnapshot : public Event<>
+{
+	std::string filename;
+};
+
+struct LoadSnapshot : public Event<>
+{
+	std::string filename;
+};
+
 struct GameObjectSync : public Event<EventType::GameObjectSync>
 {
 	enum Target
@@ -200,19 +239,56 @@ struct GameObjectSync : public Event<EventType::GameObjectSync>
 		serializer(sync_id);
 		serializer(object_count);
 
-		for (uint32_t i = 0; i < object_count; ++i)
-			serializer(object_states[i]);
+		if (object_count > MAX_GAME_OBJECTS_PER_SYNC)
+			throw raz::SerializationError();
+
+		serializer(object_states, object_count);
+	}
+};
+
+struct HighscoreEntry
+{
+	uint16_t player_id;
+	uint32_t score;
+	bool removed; // player left, there is no score
+
+	template<class Serializer>
+	void operator()(Serializer& serializer)
+	{
+		uint32_t key = ((uint32_t)player_id << 1) | (removed ? 1 : 0);
+		serializer(raz::varint(key));
+
+		if (key > 0x1FFFF)
+			throw raz::SerializationError();
+
+		player_id = (uint16_t)(key >> 1);
+		removed = (key & 1) != 0;
+
+		if (!removed)
+			serializer(raz::varint(score));
 	}
 };
 
 struct Highscore : public Event<EventType::Highscore>
 {
-	int32_t highscore[MAX_PLAYERS];
+	bool full; // the entries replace the whole highscore instead of updating it
+	std::vector<HighscoreEntry> entries; // at most MAX_HIGHSCORE_ENTRIES_PER_SYNC
 
 	template<class Serializer>
 	void operator()(Serializer& serializer)
 	{
-		for (int i = 0; i < MAX_PLAYERS; ++i)
-			serializer(highscore[i]);
+		uint8_t _full = full ? 1 : 0;
+		uint32_t entry_count = (uint32_t)entries.size();
+		serializer(_full);
+		serializer(raz::varint(entry_count));
+
+		if (entry_count > MAX_HIGHSCORE_ENTRIES_PER_SYNC)
+			throw raz::SerializationError();
+
+		full = (_full != 0);
+		entries.resize(entry_count);
+
+		for (auto& entry : entries)
+			serializer(entry);
 	}
 };
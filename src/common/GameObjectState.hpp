@@ -19,6 +19,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #pragma once
 
 #include <cstdint>
+#include <raz/serialization.hpp>
 
 struct GameObjectState
 {
@@ -36,3 +37,13 @@ struct GameObjectState
 		serializer(player_id)(object_id)(radius)(position_x)(position_y)(velocity_x)(velocity_y);
 	}
 };
+
+static_assert(sizeof(GameObjectState) == 2 * sizeof(uint16_t) + 5 * sizeof(float), "GameObjectState has padding");
+
+namespace raz
+{
+	template<>
+	struct IsBitwiseSerializable<GameObjectState> : std::true_type
+	{
+	};
+}
@@ -18,6 +18,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #pragma once
 
+#include <vector>
 #include "common/Config.hpp"
 #include "common/Events.hpp"
 
@@ -35,19 +36,20 @@ class IApplication
 {
 public:
 	// I don't need virtual destructor
+	// events are taken by value so the last thread they get posted to can have them moved
 	virtual GameMode getGameMode() const = 0;
 	virtual PlayerManager* getPlayerManager() = 0;
 	virtual void exit(int exit_code, const char* msg = nullptr) = 0;
-	virtual void handle(const Connected& e, EventSource src) = 0;
-	virtual void handle(const Disconnected& e, EventSource src) = 0;
-	virtual void handle(const SwitchPlayer& e, EventSource src) = 0;
-	virtual void handle(const Message& e, EventSource src) = 0;
-	virtual void handle(const AddGameObject& e, EventSource src) = 0;
-	virtual void handle(const MergeGameObjects& e, EventSource src) = 0;
-	virtual void handle(const RemoveGameObjectsNearMouse& e, EventSource src) = 0;
-	virtual void handle(const RemoveGameObject& e, EventSource src) = 0;
-	virtual void handle(const RemovePlayerGameObjects& e, EventSource src) = 0;
-	virtual void handle(const GameObjectSync& e, EventSource src) = 0;
-	virtual void handle(const GameObjectSyncRequest& e, EventSource src) = 0;
-	virtual void handle(const Highscore& e, EventSource src) = 0;
+	virtual void handle(Connected e, EventSource src) = 0;
+	virtual void handle(Disconnected e, EventSource src) = 0;
+	virtual void handle(SwitchPlayer e, EventSource src) = 0;
+	virtual void handle(Message e, EventSource src) = 0;
+	virtual void handle(AddGameObject e, EventSource src) = 0;
+	virtual void handle(RemoveGameObjectsNearMouse e, EventSource src) = 0;
+	virtual void handle(RemoveGameObject e, EventSource src) = 0;
+	virtual void handle(RemovePlayerGameObjects e, EventSource src) = 0;
+	virtual void handle(GameObjectSync e, EventSource src) = 0;
+	virtual void handle(const std::vector<GameObjectSync>& batch, EventSource src) = 0; // syncs with the same target
+	virtual void handle(GameObjectSyncRequest e, EventSource src) = 0;
+	virtual void handle(Highscore e, EventSource src) = 0;
 };
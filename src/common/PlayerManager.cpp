@@ -20,51 +20,108 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #include "common/Events.hpp"
 #include "common/PlayerManager.hpp"
 
+// raz::ColorTable darkens the colors with every 6 players, past 48 they would fade into black
+static constexpr size_t PLAYER_COLOR_COUNT = 48;
+
 PlayerManager::PlayerManager() :
+	m_max_players(0),
+	m_max_game_objects_per_player(0),
+	m_player_count(0),
+	m_local_player(nullptr),
 	m_last_player_id(1)
 {
+	setCapacity(DEFAULT_MAX_PLAYERS, DEFAULT_MAX_GAME_OBJECTS_PER_PLAYER);
+	reset();
+}
+
+PlayerManager::~PlayerManager()
+{
+}
+
+bool PlayerManager::setCapacity(uint16_t max_players, uint16_t max_game_objects_per_player)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	if (max_players < 2 || max_game_objects_per_player < 1)
+		return false;
+
+	for (size_t i = max_players; i < m_player_slots.size(); ++i)
+	{
+		if (m_player_slots[i])
+			return false;
+	}
+
 	raz::ColorTable color_table;
 
-	for (uint16_t i = 0; i < MAX_PLAYERS; ++i)
+	for (size_t i = m_players.size(); i < max_players; ++i)
 	{
-		m_players[i].player_id = i;
+		Player player;
+		player.player_id = (uint16_t)i;
+		player.highscore = 0;
+		player.data = nullptr;
 
 		if (i == 0)
 		{
-			m_players[i].color = sf::Color::Black;
+			player.color = sf::Color::Black;
 		}
 		else
 		{
-			raz::Color color = color_table[i - 1];
-			m_players[i].color = sf::Color(color.r, color.g, color.b);
+			raz::Color color = color_table[(i - 1) % PLAYER_COLOR_COUNT];
+			player.color = sf::Color(color.r, color.g, color.b);
 		}
+
+		m_players.push_back(player);
 	}
 
-	reset();
+	m_player_slots.resize(max_players, false);
+	m_max_players = max_players;
+	m_max_game_objects_per_player = max_game_objects_per_player;
+	return true;
 }
 
-PlayerManager::~PlayerManager()
+uint16_t PlayerManager::getMaxPlayers() const
 {
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return m_max_players;
 }
 
-const Player* PlayerManager::addPlayer()
+uint16_t PlayerManager::getMaxGameObjectsPerPlayer() const
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	auto player_slots = m_player_slots.falsebits();
-	auto slot = player_slots.begin();
+	return m_max_game_objects_per_player;
+}
 
-	if (slot == player_slots.end())
-	{
-		return nullptr;
-	}
-	else
+const Player* PlayerManager::addPlayer()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	for (uint16_t slot = 0; slot < m_max_players; ++slot)
 	{
-		m_player_slots.set(*slot);
-		Player* player = &m_players[*slot];
-		player->last_updated = std::chrono::steady_clock::now();
-		return player;
+		if (!m_player_slots[slot])
+		{
+			setPlayerSlot(slot, true);
+			Player* player = &m_players[slot];
+			player->last_updated = std::chrono::steady_clock::now();
+			return player;
+		}
 	}
+
+	return nullptr;
+}
+
+const Player* PlayerManager::addPlayer(uint16_t player_id)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	if (player_id >= m_max_players || m_player_slots[player_id])
+		return nullptr;
+
+	setPlayerSlot(player_id, true);
+	Player* player = &m_players[player_id];
+	player->last_updated = std::chrono::steady_clock::now();
+	return player;
 }
 
 const Player* PlayerManager::addLocalPlayer()
@@ -77,15 +134,15 @@ const Player* PlayerManager::addLocalPlayer(uint16_t player_id)
 	std::lock_guard<std::mutex> guard(m_mutex);
 
 	if (m_local_player
-		|| player_id >= MAX_PLAYERS
-		|| m_player_slots.isset(player_id))
+		|| player_id >= m_max_players
+		|| m_player_slots[player_id])
 	{
 		return nullptr;
 	}
 
 	m_last_player_id = player_id;
 
-	m_player_slots.set(player_id);
+	setPlayerSlot(player_id, true);
 	m_local_player = &m_players[player_id];
 	m_local_player->last_updated = std::chrono::steady_clock::now();
 	return m_local_player;
@@ -95,7 +152,7 @@ const Player* PlayerManager::getPlayer(uint16_t player_id) const
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	if (player_id >= MAX_PLAYERS || !m_player_slots.isset(player_id))
+	if (!isPlayer(player_id))
 		return nullptr;
 	else
 		return &m_players[player_id];
@@ -110,9 +167,9 @@ const Player* PlayerManager::findPlayer(const void* data)
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	for (auto slot : m_player_slots.truebits())
+	for (uint16_t slot = 0; slot < m_max_players; ++slot)
 	{
-		if (m_players[slot].data == data)
+		if (m_player_slots[slot] && m_players[slot].data == data)
 			return &m_players[slot];
 	}
 
@@ -123,14 +180,14 @@ bool PlayerManager::switchPlayer(uint16_t player_id, uint16_t new_player_id)
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	if (player_id >= MAX_PLAYERS || new_player_id >= MAX_PLAYERS)
+	if (player_id >= m_max_players || new_player_id >= m_max_players)
 		return false;
 
-	if (!m_player_slots.isset(player_id) || m_player_slots.isset(new_player_id))
+	if (!m_player_slots[player_id] || m_player_slots[new_player_id])
 		return false;
 
-	m_player_slots.set(new_player_id);
-	m_player_slots.unset(player_id);
+	setPlayerSlot(new_player_id, true);
+	setPlayerSlot(player_id, false);
 	std::swap(m_players[player_id].highscore, m_players[new_player_id].highscore);
 	std::swap(m_players[player_id].last_updated, m_players[new_player_id].last_updated);
 	std::swap(m_players[player_id].data, m_players[new_player_id].data);
@@ -148,10 +205,10 @@ void PlayerManager::removePlayer(uint16_t player_id)
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	if (player_id >= MAX_PLAYERS)
+	if (player_id >= m_max_players)
 		return;
 
-	m_player_slots.unset(player_id);
+	setPlayerSlot(player_id, false);
 	Player* player = &m_players[player_id];
 	player->highscore = 0;
 	player->last_updated = std::chrono::time_point<std::chrono::steady_clock>();
@@ -160,7 +217,9 @@ void PlayerManager::removePlayer(uint16_t player_id)
 
 sf::Color PlayerManager::getPlayerColor(uint16_t player_id)
 {
-	if (player_id >= MAX_PLAYERS)
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	if (player_id >= m_players.size())
 		return sf::Color::Black;
 	else
 		return m_players[player_id].color;
@@ -170,37 +229,116 @@ size_t PlayerManager::getPlayerCount() const
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	return m_player_slots.truebits().count();
+	return m_player_count;
+}
+
+void PlayerManager::getHighscore(std::vector<HighscoreEntry>& highscore)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	highscore.clear();
+	highscore.reserve(m_player_count);
+
+	m_sent_slots = m_player_slots;
+	m_sent_scores.resize(m_max_players);
+
+	for (uint16_t slot = 0; slot < m_max_players; ++slot)
+	{
+		if (m_player_slots[slot])
+		{
+			HighscoreEntry entry;
+			entry.player_id = slot;
+			entry.score = m_players[slot].highscore;
+			entry.removed = false;
+			highscore.push_back(entry);
+
+			m_sent_scores[slot] = entry.score;
+		}
+	}
 }
 
-void PlayerManager::getHighscore(Highscore& highscore) const
+bool PlayerManager::getHighscoreChanges(std::vector<HighscoreEntry>& changes)
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	for (size_t i = 0; i < MAX_PLAYERS; ++i)
+	bool joined = false;
+
+	changes.clear();
+	m_sent_slots.resize(m_max_players, false);
+	m_sent_scores.resize(m_max_players, 0);
+
+	for (uint16_t slot = 0; slot < m_max_players; ++slot)
 	{
-		if (m_player_slots.isset(i))
-			highscore.highscore[i] = m_players[i].highscore;
-		else
-			highscore.highscore[i] = -1;
+		bool in_use = m_player_slots[slot];
+		uint32_t score = m_players[slot].highscore;
+
+		if (!in_use && !m_sent_slots[slot])
+			continue;
+
+		if (in_use && m_sent_slots[slot] && score == m_sent_scores[slot])
+			continue;
+
+		if (in_use && !m_sent_slots[slot])
+			joined = true;
+
+		HighscoreEntry entry;
+		entry.player_id = slot;
+		entry.score = score;
+		entry.removed = !in_use;
+		changes.push_back(entry);
+
+		m_sent_slots[slot] = in_use;
+		m_sent_scores[slot] = score;
 	}
+
+	return joined;
 }
 
 void PlayerManager::addScore(uint16_t player_id, uint32_t score)
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	if (player_id >= MAX_PLAYERS || !m_player_slots.isset(player_id))
+	if (!isPlayer(player_id))
 		return;
 
 	m_players[player_id].highscore += score;
 }
 
+void PlayerManager::getScores(std::vector<HighscoreEntry>& scores) const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	scores.clear();
+
+	for (uint16_t slot = 0; slot < m_max_players; ++slot)
+	{
+		if (m_player_slots[slot])
+		{
+			HighscoreEntry entry;
+			entry.player_id = slot;
+			entry.score = m_players[slot].highscore;
+			entry.removed = false;
+			scores.push_back(entry);
+		}
+	}
+}
+
+void PlayerManager::setScores(const std::vector<HighscoreEntry>& scores)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	for (const HighscoreEntry& entry : scores)
+	{
+		if (!entry.removed && isPlayer(entry.player_id))
+			m_players[entry.player_id].highscore = entry.score;
+	}
+}
+
 uint32_t PlayerManager::subtractScore(uint16_t player_id, uint32_t score)
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	if (player_id >= MAX_PLAYERS || !m_player_slots.isset(player_id))
+	if (!isPlayer(player_id))
 		return 0;
 
 	if (score > m_players[player_id].highscore)
@@ -214,16 +352,36 @@ void PlayerManager::reset()
 {
 	std::lock_guard<std::mutex> guard(m_mutex);
 
-	m_player_slots.reset();
+	m_player_slots.assign(m_max_players, false);
+	m_player_count = 0;
+	m_sent_slots.clear();
+	m_sent_scores.clear();
 	m_local_player = nullptr;
 
-	for (uint16_t i = 0; i < MAX_PLAYERS; ++i)
+	for (Player& player : m_players)
 	{
-		Player* player = &m_players[i];
-		player->highscore = 0;
-		player->last_updated = std::chrono::time_point<std::chrono::steady_clock>();
-		player->data = nullptr;
+		player.highscore = 0;
+		player.last_updated = std::chrono::time_point<std::chrono::steady_clock>();
+		player.data = nullptr;
 	}
 
-	m_player_slots.set(0); // add system player
+	setPlayerSlot(0, true); // add system player
+}
+
+bool PlayerManager::isPlayer(uint16_t player_id) const
+{
+	return (player_id < m_max_players && m_player_slots[player_id]);
+}
+
+void PlayerManager::setPlayerSlot(uint16_t player_id, bool in_use)
+{
+	if (m_player_slots[player_id] == in_use)
+		return;
+
+	m_player_slots[player_id] = in_use;
+
+	if (in_use)
+		++m_player_count;
+	else
+		--m_player_count;
 }
@@ -20,13 +20,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #include <chrono>
 #include <cstdint>
+#include <deque>
 #include <mutex>
+#include <vector>
 #include <SFML/Graphics/Color.hpp>
-#include <raz/bitset.hpp>
 #include "common/Config.hpp"
 
 class Application;
-struct Highscore;
+struct HighscoreEntry;
 
 struct Player
 {
@@ -42,7 +43,11 @@ class PlayerManager
 public:
 	PlayerManager();
 	~PlayerManager();
+	bool setCapacity(uint16_t max_players, uint16_t max_game_objects_per_player);
+	uint16_t getMaxPlayers() const;
+	uint16_t getMaxGameObjectsPerPlayer() const;
 	const Player* addPlayer();
+	const Player* addPlayer(uint16_t player_id); // only if that slot is free
 	const Player* addLocalPlayer();
 	const Player* addLocalPlayer(uint16_t player_id);
 	const Player* getPlayer(uint16_t player_id) const;
@@ -52,8 +57,11 @@ public:
 	void removePlayer(uint16_t player_id);
 	sf::Color getPlayerColor(uint16_t player_id);
 	size_t getPlayerCount() const;
-	void getHighscore(Highscore& highscore) const;
+	void getHighscore(std::vector<HighscoreEntry>& highscore);
+	bool getHighscoreChanges(std::vector<HighscoreEntry>& changes); // returns true if a player joined since the last call
 	void addScore(uint16_t player_id, uint32_t score);
+	void getScores(std::vector<HighscoreEntry>& scores) const; // unlike getHighscore, it doesn't count as sent
+	void setScores(const std::vector<HighscoreEntry>& scores); // players that are not in use are skipped
 	uint32_t subtractScore(uint16_t player_id, uint32_t score);
 
 protected:
@@ -62,8 +70,16 @@ protected:
 
 private:
 	mutable std::mutex m_mutex;
-	Player m_players[MAX_PLAYERS];
-	raz::Bitset<MAX_PLAYERS> m_player_slots;
+	std::deque<Player> m_players; // only grows, so Player pointers stay valid
+	std::vector<bool> m_player_slots;
+	uint16_t m_max_players;
+	uint16_t m_max_game_objects_per_player;
+	size_t m_player_count;
+	std::vector<bool> m_sent_slots;     // the highscore as it was last handed out
+	std::vector<uint32_t> m_sent_scores;
 	Player* m_local_player;
 	uint16_t m_last_player_id;
+
+	bool isPlayer(uint16_t player_id) const;
+	void setPlayerSlot(uint16_t player_id, bool in_use);
 };
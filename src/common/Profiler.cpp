@@ -0,0 +1,193 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "common/Profiler.hpp"
+
+static_assert((PROFILER_BUFFER_SIZE & (PROFILER_BUFFER_SIZE - 1)) == 0, "PROFILER_BUFFER_SIZE should be a power of 2");
+
+struct ProfilerRecord
+{
+	const char* zone;
+	uint64_t start;
+	uint64_t duration;
+};
+
+struct ProfilerBuffer
+{
+	ProfilerRecord records[PROFILER_BUFFER_SIZE];
+	std::atomic<uint64_t> head; // samples recorded so far, written by the owner thread
+	std::atomic<bool> in_use; // the buffer of an exited thread goes to the next new thread
+	std::string name; // guarded by the mutex of ProfilerRegistry
+
+	ProfilerBuffer() :
+		head(0),
+		in_use(true)
+	{
+	}
+};
+
+struct ProfilerRegistry
+{
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ProfilerBuffer>> buffers; // only grows, indexed by Sample::thread
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+struct ProfilerThread
+{
+	ProfilerBuffer* buffer = nullptr;
+
+	~ProfilerThread()
+	{
+		if (buffer)
+			buffer->in_use.store(false, std::memory_order_release);
+	}
+};
+
+static thread_local ProfilerThread t_profiler_thread;
+
+static ProfilerRegistry& getRegistry()
+{
+	static ProfilerRegistry registry;
+	return registry;
+}
+
+static ProfilerBuffer* getThreadBuffer()
+{
+	ProfilerThread& thread = t_profiler_thread;
+	if (thread.buffer)
+		return thread.buffer;
+
+	ProfilerRegistry& registry = getRegistry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+
+	size_t index = 0;
+	for (; index < registry.buffers.size(); ++index)
+	{
+		bool in_use = false;
+		if (registry.buffers[index]->in_use.compare_exchange_strong(in_use, true, std::memory_order_acquire))
+			break;
+	}
+
+	if (index == registry.buffers.size())
+		registry.buffers.emplace_back(new ProfilerBuffer());
+
+	thread.buffer = registry.buffers[index].get();
+	thread.buffer->name = "thread " + std::to_string(index);
+	return thread.buffer;
+}
+
+uint64_t Profiler::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - getRegistry().epoch).count();
+}
+
+void Profiler::record(const char* zone, uint64_t start, uint64_t end)
+{
+	ProfilerBuffer* buffer = getThreadBuffer();
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+
+	ProfilerRecord& record = buffer->records[head & (PROFILER_BUFFER_SIZE - 1)];
+	record.zone = zone;
+	record.start = start;
+	record.duration = end - start;
+
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const char* name)
+{
+	ProfilerBuffer* buffer = getThreadBuffer();
+
+	std::lock_guard<std::mutex> guard(getRegistry().mutex);
+	buffer->name = name;
+}
+
+void Profiler::read(Cursor& cursor, std::vector<Sample>& samples)
+{
+	ProfilerRegistry& registry = getRegistry();
+	std::lock_guard<std::mutex> guard(registry.mutex);
+
+	cursor.resize(registry.buffers.size(), 0);
+
+	for (uint32_t thread = 0; thread < registry.buffers.size(); ++thread)
+	{
+		const ProfilerBuffer& buffer = *registry.buffers[thread];
+		uint64_t head = buffer.head.load(std::memory_order_acquire);
+		uint64_t first = std::max(cursor[thread], (head > PROFILER_BUFFER_SIZE) ? head - PROFILER_BUFFER_SIZE : 0);
+		size_t begin = samples.size();
+
+		for (uint64_t i = first; i < head; ++i)
+		{
+			const ProfilerRecord& record = buffer.records[i & (PROFILER_BUFFER_SIZE - 1)];
+			samples.push_back({ record.zone, record.start, record.duration, thread });
+		}
+
+		// the owner may have lapped us while copying, the record it writes now is lost too
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t new_head = buffer.head.load(std::memory_order_relaxed);
+		uint64_t valid = (new_head >= PROFILER_BUFFER_SIZE) ? new_head - PROFILER_BUFFER_SIZE + 1 : 0;
+
+		if (valid > first)
+			samples.erase(samples.begin() + begin, samples.begin() + begin + (size_t)std::min(valid, head) - (size_t)first);
+
+		cursor[thread] = head;
+	}
+}
+
+bool Profiler::exportTrace(const char* filename)
+{
+	Cursor cursor;
+	std::vector<Sample> samples;
+	read(cursor, samples);
+
+	std::FILE* file = std::fopen(filename, "w");
+	if (!file)
+		return false;
+
+	std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	{
+		ProfilerRegistry& registry = getRegistry();
+		std::lock_guard<std::mutex> guard(registry.mutex);
+
+		for (size_t thread = 0; thread < registry.buffers.size(); ++thread)
+		{
+			std::fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n",
+				(unsigned)thread, registry.buffers[thread]->name.c_str());
+		}
+	}
+
+	for (const Sample& sample : samples)
+	{
+		std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f},\n",
+			sample.zone, sample.thread, sample.start / 1000.0, sample.duration / 1000.0);
+	}
+
+	// closes the array without a trailing comma
+	std::fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"" APP_NAME "\"}}\n]}\n");
+
+	return (std::fclose(file) == 0);
+}
@@ -0,0 +1,77 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "common/Config.hpp"
+
+/*
+ * Scoped timing zones. Every thread records its zones into its own ring of PROFILER_BUFFER_SIZE
+ * samples without locking: the ring overwrites the oldest samples instead of blocking, and the
+ * readers (the overlay of GameWindow and the trace export) drop whatever got overwritten while
+ * they were copying it. Zone names must be string literals, only the pointer is stored.
+ */
+class Profiler
+{
+public:
+	struct Sample
+	{
+		const char* zone;
+		uint64_t start; // ns since the first use of the profiler
+		uint64_t duration; // ns
+		uint32_t thread;
+	};
+
+	typedef std::vector<uint64_t> Cursor; // per thread positions of a reader
+
+	static uint64_t now();
+	static void record(const char* zone, uint64_t start, uint64_t end);
+	static void setThreadName(const char* name);
+	static void read(Cursor& cursor, std::vector<Sample>& samples); // appends the samples recorded since the last read with this cursor
+	static bool exportTrace(const char* filename); // writes the buffered samples as Chrome trace JSON (chrome://tracing)
+};
+
+class ProfilerZone
+{
+public:
+	ProfilerZone(const char* zone) :
+		m_zone(zone),
+		m_start(Profiler::now())
+	{
+	}
+
+	~ProfilerZone()
+	{
+		Profiler::record(m_zone, m_start, Profiler::now());
+	}
+
+private:
+	const char* m_zone;
+	uint64_t m_start;
+};
+
+#define PROFILE_ZONE_CONCAT2(a, b) a##b
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT2(a, b)
+
+#if PROFILER
+#define PROFILE_ZONE(zone) ProfilerZone PROFILE_ZONE_CONCAT(_profiler_zone_, __LINE__)(zone)
+#else
+#define PROFILE_ZONE(zone)
+#endif
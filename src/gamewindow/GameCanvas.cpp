@@ -17,6 +17,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 */
 
 #include "common/PlayerManager.hpp"
+#include "common/Profiler.hpp"
 #include "gamewindow/GameCanvas.hpp"
 
 /*
@@ -91,6 +92,8 @@ GameCanvas::~GameCanvas()
 
 void GameCanvas::render(sf::RenderTarget& target)
 {
+	PROFILE_ZONE("GameCanvas::render");
+
 	target.setView(m_ui_view);
 	target.draw(m_canvas_quad);
 
@@ -140,10 +143,12 @@ void GameCanvas::render(const GameObjectState& state)
 
 void GameCanvas::render(const RenderJob& job)
 {
+	PROFILE_ZONE("GameCanvas::renderJob");
+
 	m_canvas.draw(m_clear_rect, sf::BlendAdd);
 
-	for (uint32_t i = 0; i < job.object_count; ++i)
-		render(job.object_states[i]);
+	for (const GameObjectState& state : job.object_states)
+		render(state);
 
 	m_canvas.display();
 }
@@ -230,13 +235,10 @@ void GameCanvas::handle(const GameObjectSync& e)
 		}
 
 		m_job.sync_id = e.sync_id;
-		m_job.object_count = 0;
+		m_job.object_states.clear();
 	}
 
-	for (uint32_t i = 0; i < e.object_count; ++i)
-	{
-		m_job.object_states[m_job.object_count++] = e.object_states[i];
-	}
+	m_job.object_states.insert(m_job.object_states.end(), e.object_states, e.object_states + e.object_count);
 }
 
 void GameCanvas::handle(const SwitchPlayer& e)
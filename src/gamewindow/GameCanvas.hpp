@@ -18,6 +18,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #pragma once
 
+#include <vector>
 #include <SFML/Graphics.hpp>
 #include <raz/timer.hpp>
 #include "common/IApplication.hpp"
@@ -37,8 +38,7 @@ private:
 	struct RenderJob
 	{
 		uint32_t sync_id = 0;
-		uint32_t object_count = 0;
-		GameObjectState object_states[MAX_GAME_OBJECTS];
+		std::vector<GameObjectState> object_states; // keeps its capacity between frames
 	};
 
 	IApplication* m_app;
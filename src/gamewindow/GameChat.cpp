@@ -74,7 +74,7 @@ void GameChat::handle(const sf::Event& e)
 		break;
 
 	case sf::Event::TextEntered:
-		if (e.text.unicode >= 32)
+		if (e.text.unicode >= 32 && m_input.getString().getSize() < MAX_MESSAGE_LENGTH)
 			m_input.setString(m_input.getString() + e.text.unicode);
 		break;
 
@@ -90,7 +90,7 @@ void GameChat::handle(const sf::Event& e)
 					if (clip0 != NULL)
 					{
 						wchar_t *c = reinterpret_cast<wchar_t*>(GlobalLock(clip0));
-						m_input.setString(m_input.getString() + sf::String(c));
+						m_input.setString((m_input.getString() + sf::String(c)).substring(0, MAX_MESSAGE_LENGTH));
 						GlobalUnlock(clip0);
 					}
 					CloseClipboard();
@@ -112,7 +112,7 @@ void GameChat::handle(const sf::Event& e)
 				Message e;
 				e.player_id = m_player->player_id;
 				e.message = m_input.getString().getData();
-				m_app->handle(e, EventSource::GameWindow);
+				m_app->handle(std::move(e), EventSource::GameWindow);
 			}
 			m_input.setString({});
 			break;
@@ -16,6 +16,7 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 */
 
+#include <algorithm>
 #include "common/PlayerManager.hpp"
 #include "gamewindow/GameFont.hpp"
 #include "gamewindow/GameHighscore.hpp"
@@ -39,10 +40,11 @@ void GameHighscore::render(sf::RenderTarget& target)
 {
 	float y_pos = 10.f;
 
-	for (Score& score : m_highscore)
+	for (const Score& score : m_highscore)
 	{
-		score.text.setPosition(m_width - score.text.getLocalBounds().width - 10.f, y_pos);
-		target.draw(score.text);
+		sf::Text& text = m_texts[score.player_id];
+		text.setPosition(m_width - text.getLocalBounds().width - 10.f, y_pos);
+		target.draw(text);
 		y_pos += MESSAGE_CHAR_SIZE + 2;
 	}
 }
@@ -59,39 +61,56 @@ void GameHighscore::handle(const sf::Event& e)
 
 void GameHighscore::handle(const Highscore& e)
 {
-	m_highscore.clear();
+	if (e.full)
+		m_highscore.clear();
 
-	for (int i = 0; i < MAX_PLAYERS; ++i)
-	{
-		if (e.highscore[i] < 0)
-			continue;
-
-		Score score;
-		score.score = e.highscore[i];
-		score.text = m_sample_score;
-		score.text.setString(std::to_string(score.score));
-		score.text.setFillColor(m_app->getPlayerManager()->getPlayerColor(i));
-
-		bool inserted = false;
-
-		for (auto it = m_highscore.begin(), end = m_highscore.end(); it != end; ++it)
-		{
-			if (score.score > it->score)
-			{
-				inserted = true;
-				m_highscore.insert(it, std::move(score));
-				break;
-			}
-		}
-
-		if (!inserted)
-		{
-			m_highscore.push_back(std::move(score));
-		}
-	}
+	for (const HighscoreEntry& entry : e.entries)
+		update(entry);
 }
 
 void GameHighscore::resize(unsigned width, unsigned height)
 {
 	m_width = (float)width;
 }
+
+void GameHighscore::update(const HighscoreEntry& entry)
+{
+	auto it = std::find_if(m_highscore.begin(), m_highscore.end(),
+		[&entry](const Score& score) { return score.player_id == entry.player_id; });
+
+	if (entry.removed)
+	{
+		if (it != m_highscore.end())
+			m_highscore.erase(it);
+		return;
+	}
+
+	if (entry.player_id >= m_texts.size())
+		m_texts.resize(entry.player_id + 1, m_sample_score);
+
+	sf::Text& text = m_texts[entry.player_id];
+
+	if (it == m_highscore.end())
+	{
+		text.setFillColor(m_app->getPlayerManager()->getPlayerColor(entry.player_id));
+	}
+	else if (it->score == entry.score)
+	{
+		return;
+	}
+	else
+	{
+		m_highscore.erase(it);
+	}
+
+	text.setString(std::to_string(entry.score));
+
+	Score score;
+	score.score = entry.score;
+	score.player_id = entry.player_id;
+
+	auto pos = std::upper_bound(m_highscore.begin(), m_highscore.end(), score,
+		[](const Score& a, const Score& b) { return a.score > b.score; });
+
+	m_highscore.insert(pos, score);
+}
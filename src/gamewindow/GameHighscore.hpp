@@ -18,7 +18,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #pragma once
 
-#include <list>
+#include <vector>
 #include <SFML/Graphics.hpp>
 #include "common/IApplication.hpp"
 
@@ -38,12 +38,15 @@ private:
 	struct Score
 	{
 		uint32_t score;
-		sf::Text text;
+		uint16_t player_id;
 	};
 
 	IApplication* m_app;
 	const GameFont* m_font;
 	sf::Text m_sample_score;
-	std::list<Score> m_highscore;
+	std::vector<Score> m_highscore; // sorted by score
+	std::vector<sf::Text> m_texts; // indexed by player_id, reused between updates
 	float m_width;
+
+	void update(const HighscoreEntry& entry);
 };
@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "common/Config.hpp"
+#include "gamewindow/GameFont.hpp"
+#include "gamewindow/GameProfiler.hpp"
+
+GameProfiler::GameProfiler(const GameFont* font) :
+	m_font(font),
+	m_visible(false)
+{
+	m_sample_text.setFont(*m_font);
+	m_sample_text.setFillColor(sf::Color::Black);
+	m_sample_text.setOutlineColor(sf::Color::White);
+	m_sample_text.setOutlineThickness(0.1f);
+	m_sample_text.setCharacterSize(MESSAGE_CHAR_SIZE);
+}
+
+GameProfiler::~GameProfiler()
+{
+}
+
+void GameProfiler::render(sf::RenderTarget& target)
+{
+	if (!m_visible)
+		return;
+
+	if (m_update_timer.peekElapsed() > PROFILER_OVERLAY_RATE)
+	{
+		update();
+		m_update_timer.reset();
+	}
+
+	float y_pos = 10.f;
+
+	for (Zone& zone : m_zones)
+	{
+		zone.text.setPosition(10.f, y_pos);
+		target.draw(zone.text);
+		y_pos += MESSAGE_CHAR_SIZE + 2;
+	}
+}
+
+void GameProfiler::handle(const sf::Event& e)
+{
+	switch (e.type)
+	{
+	case sf::Event::KeyPressed:
+		if (e.key.code == sf::Keyboard::F3)
+		{
+			m_visible = !m_visible;
+			if (m_visible)
+				update();
+		}
+		break;
+	}
+}
+
+void GameProfiler::update()
+{
+	m_samples.clear();
+	Profiler::read(m_cursor, m_samples);
+
+	for (const Profiler::Sample& sample : m_samples)
+	{
+		Zone& zone = getZone(sample.zone);
+
+		if (zone.durations.size() < PROFILER_OVERLAY_SAMPLES)
+		{
+			zone.durations.push_back(sample.duration);
+		}
+		else
+		{
+			zone.durations[zone.next] = sample.duration;
+			zone.next = (zone.next + 1) % PROFILER_OVERLAY_SAMPLES;
+		}
+	}
+
+	for (Zone& zone : m_zones)
+	{
+		m_sorted = zone.durations;
+		size_t p50 = (m_sorted.size() - 1) / 2;
+		size_t p99 = (m_sorted.size() - 1) * 99 / 100;
+		std::nth_element(m_sorted.begin(), m_sorted.begin() + p99, m_sorted.end());
+		std::nth_element(m_sorted.begin(), m_sorted.begin() + p50, m_sorted.begin() + p99);
+
+		char text[128];
+		std::snprintf(text, sizeof(text), "%s  p50 %.3f ms  p99 %.3f ms", zone.name, m_sorted[p50] / 1000000.0, m_sorted[p99] / 1000000.0);
+		zone.text.setString(text);
+	}
+}
+
+GameProfiler::Zone& GameProfiler::getZone(const char* name)
+{
+	auto it = std::lower_bound(m_zones.begin(), m_zones.end(), name,
+		[](const Zone& zone, const char* name) { return std::strcmp(zone.name, name) < 0; });
+
+	if (it == m_zones.end() || std::strcmp(it->name, name) != 0)
+	{
+		Zone zone;
+		zone.name = name;
+		zone.next = 0;
+		zone.text = m_sample_text;
+		it = m_zones.insert(it, std::move(zone));
+	}
+
+	return *it;
+}
@@ -0,0 +1,58 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+#include <raz/timer.hpp>
+#include "common/Profiler.hpp"
+
+class GameFont;
+
+// overlay with the rolling p50/p99 of every profiler zone, toggled by F3
+class GameProfiler
+{
+public:
+	GameProfiler(const GameFont* font);
+	~GameProfiler();
+	void render(sf::RenderTarget& target);
+	void handle(const sf::Event& e);
+
+private:
+	struct Zone
+	{
+		const char* name;
+		std::vector<uint64_t> durations; // the last PROFILER_OVERLAY_SAMPLES, used as a ring
+		size_t next;
+		sf::Text text;
+	};
+
+	const GameFont* m_font;
+	sf::Text m_sample_text;
+	std::vector<Zone> m_zones; // sorted by name
+	std::vector<uint64_t> m_sorted; // reused by update
+	std::vector<Profiler::Sample> m_samples;
+	Profiler::Cursor m_cursor;
+	raz::Timer m_update_timer;
+	bool m_visible;
+
+	void update();
+	Zone& getZone(const char* name);
+};
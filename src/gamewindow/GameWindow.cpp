@@ -28,8 +28,11 @@ GameWindow::GameWindow(IApplication* app, const Player* player) :
 	m_player(player),
 	m_canvas(app, player),
 	m_chat(app, player, &m_font),
-	m_highscore(app, &m_font)
+	m_highscore(app, &m_font),
+	m_profiler(&m_font)
 {
+	Profiler::setThreadName("GameWindow");
+
 	sf::ContextSettings settings;
 	settings.antialiasingLevel = ANTIALIASING_LEVEL;
 
@@ -79,11 +82,15 @@ void GameWindow::operator()()
 		m_canvas.handle(event);
 		m_chat.handle(event);
 		m_highscore.handle(event);
+		m_profiler.handle(event);
 	}
 
 	m_canvas.render(m_window);
 	m_chat.render(m_window);
 	m_highscore.render(m_window);
+	m_profiler.render(m_window);
+
+	PROFILE_ZONE("GameWindow::display");
 	m_window.display();
 }
 
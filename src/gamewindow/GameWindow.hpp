@@ -27,6 +27,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #include "gamewindow/GameCanvas.hpp"
 #include "gamewindow/GameChat.hpp"
 #include "gamewindow/GameHighscore.hpp"
+#include "gamewindow/GameProfiler.hpp"
 
 class GameWindow
 {
@@ -50,6 +51,7 @@ private:
 	GameCanvas m_canvas;
 	GameChat m_chat;
 	GameHighscore m_highscore;
+	GameProfiler m_profiler;
 
 	void updateTitle();
 };
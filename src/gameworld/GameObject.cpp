@@ -21,7 +21,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #include "common/GameObjectState.hpp"
 #include "gameworld/GameObject.hpp"
 
-void GameObject::fill(GameObjectState& state) const
+void GameObject::fill(GameObjectState& state, uint64_t tick) const
 {
 	state.player_id = player_id;
 	state.object_id = object_id;
@@ -31,7 +31,7 @@ void GameObject::fill(GameObjectState& state) const
 	state.velocity_x = body->GetLinearVelocity().x;
 	state.velocity_y = body->GetLinearVelocity().y;
 
-	if (player_id == 0 && creation > std::chrono::steady_clock::now() - std::chrono::milliseconds(GAME_SYNC_RATE))
+	if (player_id == 0 && creation + WORLD_TICKS(GAME_SYNC_RATE) > tick)
 	{
 		state.position_x = root_position_x;
 		state.position_y = root_position_y;
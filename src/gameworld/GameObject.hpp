@@ -18,7 +18,6 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #pragma once
 
-#include <chrono>
 #include <cstdint>
 
 class b2Body;
@@ -34,9 +33,10 @@ struct GameObject
 	uint32_t value;
 	float root_position_x;
 	float root_position_y;
-	std::chrono::steady_clock::time_point creation;
-	std::chrono::steady_clock::time_point expiry;
+	uint64_t creation; // world tick
+	uint64_t expiry; // world tick
+	bool merged; // merged away in the current step, deleted once the merge candidates are resolved
 
-	void fill(GameObjectState& state) const;
+	void fill(GameObjectState& state, uint64_t tick) const;
 	void apply(const GameObjectState& state);
 };
@@ -0,0 +1,90 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <raz/hash.hpp>
+#include <raz/serialization.hpp>
+#include "common/Events.hpp"
+
+/*
+A snapshot file is a header, the scores of the players in use, then the game objects
+as fixed size records that are copied in one piece. Times are in world ticks relative to
+the tick the snapshot was taken at, so they can be restored into a world at any tick.
+*/
+struct GameSnapshotHeader
+{
+	static constexpr uint32_t MAGIC = (uint32_t)raz::hash("RazzGravitasSnapshot");
+	static constexpr uint32_t VERSION = 2;
+
+	uint32_t magic;
+	uint32_t version;
+	uint16_t max_players;
+	uint16_t max_game_objects_per_player;
+	uint32_t score_count;
+	uint32_t object_count;
+
+	template<class Serializer>
+	void operator()(Serializer& serializer)
+	{
+		serializer(magic)(version)(max_players)(max_game_objects_per_player)(score_count)(object_count);
+	}
+};
+
+struct GameObjectSnapshot
+{
+	uint16_t player_id;
+	uint16_t object_id;
+	uint32_t value;
+	float radius;
+	float root_position_x;
+	float root_position_y;
+	float position_x;
+	float position_y;
+	float velocity_x;
+	float velocity_y;
+	int32_t creation; // ticks
+	int32_t expiry; // ticks
+
+	template<class Serializer>
+	void operator()(Serializer& serializer)
+	{
+		serializer(player_id)(object_id)(value)(radius)(root_position_x)(root_position_y)
+			(position_x)(position_y)(velocity_x)(velocity_y)(creation)(expiry);
+	}
+};
+
+static_assert(sizeof(GameObjectSnapshot) == 2 * sizeof(uint16_t) + sizeof(uint32_t) + 7 * sizeof(float) + 2 * sizeof(int32_t), "GameObjectSnapshot has padding");
+
+namespace raz
+{
+	template<>
+	struct IsBitwiseSerializable<GameObjectSnapshot> : std::true_type
+	{
+	};
+}
+
+// a snapshot taken in memory, it can be written to a file by any thread
+struct GameSnapshot
+{
+	GameSnapshotHeader header;
+	std::vector<HighscoreEntry> scores;
+	std::vector<GameObjectSnapshot> objects;
+};
@@ -16,19 +16,33 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 */
 
-#include <cstring>
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <stdexcept>
+#include <string>
+#include <raz/mappedfile.hpp>
 #include "common/PlayerManager.hpp"
+#include "common/Profiler.hpp"
 #include "gameworld/GameWorld.hpp"
+#include "gameworld/InputLog.hpp"
 
 static constexpr double PI = 3.14159265358979323846;
 
-static std::chrono::milliseconds getGameObjectDuration(float radius)
+static uint64_t getGameObjectDuration(float radius) // in ticks
 {
 	float t = 1.f - ((radius - MIN_GAME_OBJECT_SIZE) / (MAX_GAME_OBJECT_SIZE - MIN_GAME_OBJECT_SIZE));
-	std::chrono::milliseconds::rep ms = (std::chrono::milliseconds::rep)(1000 * (t * (MAX_GAME_OBJECT_DURATION - MIN_GAME_OBJECT_DURATION) + MIN_GAME_OBJECT_DURATION));
-	return std::chrono::milliseconds(ms);
+	return WORLD_TICKS(1000 * (t * (MAX_GAME_OBJECT_DURATION - MIN_GAME_OBJECT_DURATION) + MIN_GAME_OBJECT_DURATION));
+}
+
+static uint64_t addTicks(uint64_t tick, int32_t ticks) // clamped to tick 0
+{
+	if (ticks < 0 && (uint64_t)-(int64_t)ticks > tick)
+		return 0;
+
+	return tick + ticks;
 }
 
 static uint32_t getGameObjectValue(float radius)
@@ -42,77 +56,137 @@ GameWorld::GameWorld(IApplication* app) :
 	m_app(app),
 	m_world(b2Vec2(0.f, 0.f)),
 	m_step_time(0.f),
+	m_ccd_motion_ratio(WORLD_CCD_MOTION_RATIO),
 	m_last_sync_id(0),
-	m_render_counter(0)
+	m_render_counter(0),
+	m_tick(0)
 {
+	Profiler::setThreadName("GameWorld");
+
 	setLevelBounds(WORLD_WIDTH, WORLD_HEIGHT);
+	m_world.SetBroadPhaseRebuildThreshold(WORLD_BROADPHASE_REBUILD_THRESHOLD);
+	m_world.SetSolverThreadCount(WORLD_SOLVER_THREADS);
 
+	// clients only learn the capacity in the Connected event, they allocate on demand
 	if (m_app->getGameMode() != GameMode::Client)
+	{
+		PlayerManager* player_mgr = m_app->getPlayerManager();
+		int32 capacity = (int32)player_mgr->getMaxPlayers() * (int32)player_mgr->getMaxGameObjectsPerPlayer();
+		m_world.ReserveCircleBodies(capacity, capacity * WORLD_RESERVED_CONTACTS_PER_GAME_OBJECT);
 		m_world.SetContactListener(this);
+	}
 
-	std::memset(m_obj_db, 0, sizeof(m_obj_db));
+	// warm restart from the last checkpoint
+	if (SNAPSHOT_RATE > 0 && m_app->getGameMode() == GameMode::Host)
+	{
+		try
+		{
+			if (loadSnapshot(SNAPSHOT_FILE) > 0)
+				sendMessage("Resumed from the last checkpoint");
+		}
+		catch (std::exception&)
+		{
+			// no checkpoint yet
+		}
+	}
+
+	if (INPUT_LOG && m_app->getGameMode() == GameMode::Host)
+		startRecording(INPUT_LOG_FILE);
 }
 
 GameWorld::~GameWorld()
 {
+	if (m_checkpoint_write.valid())
+		m_checkpoint_write.wait();
 }
 
 void GameWorld::operator()()
 {
 	float delta = 0.001f * m_timer.getElapsed();
 	for (m_step_time += delta; m_step_time >= WORLD_STEP; m_step_time -= WORLD_STEP)
+		step();
+
+	if (m_app->getGameMode() == GameMode::Host
+		&& m_highscore_timer.peekElapsed() > HIGHSCORE_SYNC_RATE)
+	{
+		syncHighscore();
+		m_highscore_timer.reset();
+	}
+
+	if (SNAPSHOT_RATE > 0 && m_app->getGameMode() == GameMode::Host)
 	{
-		for (b2Body* body = m_world.GetBodyList(); body != 0; body = body->GetNext())
+		finishCheckpoint();
+
+		// a checkpoint still being written delays the next one
+		if (!m_checkpoint_write.valid() && m_snapshot_timer.peekElapsed() > SNAPSHOT_RATE)
 		{
-			GameObject* obj = static_cast<GameObject*>(body->GetUserData());
-			if (obj == 0)
-				continue;
+			startCheckpoint();
+			m_snapshot_timer.reset();
+		}
+	}
 
-			b2Vec2 p = body->GetPosition();
+	syncRenderer();
+}
 
-			for (b2Body* body2 = body->GetNext(); body2 != 0; body2 = body2->GetNext())
-			{
-				GameObject* obj2 = static_cast<GameObject*>(body2->GetUserData());
-				if (obj2 == 0)
-					continue;
-
-				b2Vec2 p2 = body2->GetPosition();
-				b2Vec2 dir = p - p2;
-				float dist = dir.LengthSquared();
-				float angle = (float)std::atan2(dir.y, dir.x) + (float)PI;
-				float force = (GRAVITY * body->GetMass() * body2->GetMass()) / dist;
-				b2Vec2 force_vect(std::cos(angle) * force, std::sin(angle) * force);
-
-				body->ApplyForceToCenter(force_vect, true);
-				body2->ApplyForceToCenter(-force_vect, true);
-			}
+unsigned GameWorld::step(StepProfile* profile)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point t0, t1, t2, t3;
 
-			if (obj->player_id == 0)
-			{
-				b2Vec2 root_p(obj->root_position_x, obj->root_position_y);
-				b2Vec2 force_vect = root_p - p;
-				body->ApplyForceToCenter(force_vect, true);
-			}
-		}
+	if (profile)
+		t0 = Clock::now();
 
-		m_world.Step(WORLD_STEP, 8, 3);
-	}
+	applyGravity();
 
-	if (m_app->getGameMode() == GameMode::Host
-		&& m_highscore_timer.peekElapsed() > HIGHSCORE_SYNC_RATE)
+	if (profile)
+		t1 = Clock::now();
+
+	updateContinuousCollision();
 	{
-		Highscore e;
-		m_app->getPlayerManager()->getHighscore(e);
-		m_app->handle(e, EventSource::GameWorld);
-		m_highscore_timer.reset();
+		PROFILE_ZONE("b2World::Step");
+		m_world.Step(WORLD_STEP, WORLD_VELOCITY_ITERATIONS, WORLD_POSITION_ITERATIONS);
 	}
 
-	syncRenderer();
+	if (profile)
+		t2 = Clock::now();
+
+	unsigned merges = mergeGameObjects();
+
+	if (profile)
+		t3 = Clock::now();
+
 	removeExpiredGameObjects();
+	++m_tick;
+
+	if (profile)
+	{
+		profile->gravity_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+		profile->step_ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+		profile->broadphase_ms = m_world.GetProfile().broadphase;
+		profile->toi_ms = m_world.GetProfile().solveTOI;
+		profile->merge_ms = std::chrono::duration<double, std::milli>(t3 - t2).count();
+		profile->expire_ms = std::chrono::duration<double, std::milli>(Clock::now() - t3).count();
+	}
+
+	return merges;
+}
+
+void GameWorld::setStepParameters(float broadphase_rebuild_threshold, int solver_threads, float ccd_motion_ratio)
+{
+	m_world.SetBroadPhaseRebuildThreshold(broadphase_rebuild_threshold);
+	m_world.SetSolverThreadCount(solver_threads);
+	m_ccd_motion_ratio = ccd_motion_ratio;
+}
+
+void GameWorld::operator()(Connected e)
+{
+	record(InputLogEntry::Join, e);
 }
 
 void GameWorld::operator()(AddGameObject e)
 {
+	record(InputLogEntry::AddGameObject, e);
+
 	if (e.radius > MAX_GAME_OBJECT_CREATION_SIZE)
 		e.radius = MAX_GAME_OBJECT_CREATION_SIZE;
 
@@ -125,15 +199,10 @@ void GameWorld::operator()(AddGameObject e)
 	}
 }
 
-void GameWorld::operator()(MergeGameObjects e)
-{
-	GameObject* obj1 = m_obj_db[e.player_id[0]][e.object_id[0]];
-	GameObject* obj2 = m_obj_db[e.player_id[1]][e.object_id[1]];
-	mergeGameObjects(obj1, obj2);
-}
-
 void GameWorld::operator()(RemoveGameObjectsNearMouse e)
 {
+	record(InputLogEntry::RemoveGameObjectsNearMouse, e);
+
 	b2Vec2 mouse(e.position_x, e.position_y);
 
 	for (b2Body* body = m_world.GetBodyList(); body != 0; )
@@ -163,11 +232,14 @@ void GameWorld::operator()(RemoveGameObjectsNearMouse e)
 
 void GameWorld::operator()(RemoveGameObject e)
 {
+	record(InputLogEntry::RemoveGameObject, e);
 	removeGameObject(e.player_id, e.object_id);
 }
 
 void GameWorld::operator()(RemovePlayerGameObjects e)
 {
+	record(InputLogEntry::Leave, e); // only sent when a player disconnects
+
 	for (b2Body* body = m_world.GetBodyList(); body != 0; )
 	{
 		b2Body* next_body = body->GetNext();
@@ -201,59 +273,84 @@ void GameWorld::operator()(GameObjectSync e)
 
 void GameWorld::operator()(GameObjectSyncRequest e)
 {
-	auto now = std::chrono::steady_clock::now();
-	int sync_packets_sent = 0;
-
-	GameObjectSync sync;
-	sync.sync_id = e.sync_id;
-	sync.object_count = 0;
-	sync.target = GameObjectSync::Target::Network;
+	m_sync_batch.clear();
+	GameObjectSync* sync = &addSync(e.sync_id, GameObjectSync::Target::Network);
 
 	for (b2Body* body = m_world.GetBodyList(); body != 0; body = body->GetNext())
 	{
 		GameObject* obj = static_cast<GameObject*>(body->GetUserData());
-		if (!obj || obj->creation > now)
+		if (!obj || obj->creation > m_tick)
 			continue;
 
-		obj->fill(sync.object_states[sync.object_count]);
-		++sync.object_count;
+		if (sync->object_count == MAX_GAME_OBJECTS_PER_SYNC)
+			sync = &addSync(e.sync_id, GameObjectSync::Target::Network);
 
-		if (sync.object_count == MAX_GAME_OBJECTS_PER_SYNC)
-		{
-			m_app->handle(sync, EventSource::GameWorld);
-			sync.object_count = 0; // reset counter to refill the struct
-			++sync_packets_sent;
-		}
+		obj->fill(sync->object_states[sync->object_count], m_tick);
+		++sync->object_count;
 	}
 
-	if (sync.object_count > 0 || sync_packets_sent == 0)
-	{
-		m_app->handle(sync, EventSource::GameWorld);
-	}
+	m_app->handle(m_sync_batch, EventSource::GameWorld);
 }
 
 void GameWorld::operator()(SwitchPlayer e)
 {
+	record(InputLogEntry::SwitchPlayer, e);
+
 	for (b2Body* body = m_world.GetBodyList(); body != 0; body = body->GetNext())
 	{
 		GameObject* obj = static_cast<GameObject*>(body->GetUserData());
 		if (obj != 0 && obj->player_id == e.player_id)
 		{
-			m_obj_db[e.player_id][obj->object_id] = nullptr;
-			m_obj_slots[e.player_id].unset(obj->object_id);
+			setGameObject(e.player_id, obj->object_id, nullptr);
 
-			if (m_obj_db[e.new_player_id][obj->object_id] != nullptr)
+			if (getGameObject(e.new_player_id, obj->object_id) != nullptr)
 				throw std::runtime_error("SwitchUser error");
 
-			m_obj_db[e.new_player_id][obj->object_id] = obj;
-			m_obj_slots[e.new_player_id].set(obj->object_id);
+			setGameObject(e.new_player_id, obj->object_id, obj);
 
 			obj->player_id = e.new_player_id;
-			obj->creation = std::chrono::steady_clock::now() + std::chrono::milliseconds(GAME_SYNC_RATE * 2);
+			obj->creation = m_tick + WORLD_TICKS(GAME_SYNC_RATE * 2);
 		}
 	}
 }
 
+void GameWorld::operator()(SaveSnapshot e)
+{
+	char msg[MAX_MESSAGE_LENGTH];
+
+	try
+	{
+		size_t objects = saveSnapshot(e.filename.c_str());
+		std::snprintf(msg, sizeof(msg), "Saved %u game objects to %.64s", (unsigned)objects, e.filename.c_str());
+	}
+	catch (std::exception&)
+	{
+		std::snprintf(msg, sizeof(msg), "Cannot save the world to %.64s", e.filename.c_str());
+	}
+
+	sendMessage(msg);
+}
+
+void GameWorld::operator()(LoadSnapshot e)
+{
+	char msg[MAX_MESSAGE_LENGTH];
+
+	try
+	{
+		size_t objects = loadSnapshot(e.filename.c_str());
+
+		recordSnapshot(); // the recorded session continues from the loaded world
+
+		std::snprintf(msg, sizeof(msg), "Loaded %u game objects from %.64s", (unsigned)objects, e.filename.c_str());
+	}
+	catch (std::exception&)
+	{
+		std::snprintf(msg, sizeof(msg), "Cannot load the world from %.64s", e.filename.c_str());
+	}
+
+	sendMessage(msg);
+}
+
 void GameWorld::operator()(std::exception& e)
 {
 	m_app->exit(-1, e.what());
@@ -273,19 +370,17 @@ void GameWorld::BeginContact(b2Contact* contact)
 	if (!obj1 || !obj2)
 		return;
 
+	// the merged object would be too big, no need to queue it
+	if (obj1->radius * obj1->radius + obj2->radius * obj2->radius > MAX_GAME_OBJECT_SIZE * MAX_GAME_OBJECT_SIZE)
+		return;
+
 	b2Vec2 dir1 = body1->GetLinearVelocity(); dir1.Normalize();
 	b2Vec2 dir2 = body2->GetLinearVelocity(); dir2.Normalize();
 	b2Vec2 dist = body1->GetPosition() - body2->GetPosition(); dist.Normalize();
 
+	// the world is locked during the step, the merge happens after it
 	if (b2Dot(dir1, dist) < -0.9f || b2Dot(dir2, -dist) < -0.9f)
-	{
-		MergeGameObjects e;
-		e.player_id[0] = obj1->player_id;
-		e.object_id[0] = obj1->object_id;
-		e.player_id[1] = obj2->player_id;
-		e.object_id[1] = obj2->object_id;
-		m_app->handle(e, EventSource::GameWorld);
-	}
+		m_merge_candidates.emplace_back(obj1, obj2);
 }
 
 void GameWorld::setLevelBounds(float width, float height)
@@ -322,19 +417,147 @@ void GameWorld::setLevelBounds(float width, float height)
 	body->CreateFixture(&fixture);
 }
 
+void GameWorld::applyGravity()
+{
+	PROFILE_ZONE("GameWorld::applyGravity");
+
+	for (b2Body* body = m_world.GetBodyList(); body != 0; body = body->GetNext())
+	{
+		GameObject* obj = static_cast<GameObject*>(body->GetUserData());
+		if (obj == 0)
+			continue;
+
+		b2Vec2 p = body->GetPosition();
+
+		for (b2Body* body2 = body->GetNext(); body2 != 0; body2 = body2->GetNext())
+		{
+			GameObject* obj2 = static_cast<GameObject*>(body2->GetUserData());
+			if (obj2 == 0)
+				continue;
+
+			b2Vec2 p2 = body2->GetPosition();
+			b2Vec2 dir = p - p2;
+			float dist = dir.LengthSquared();
+			float angle = (float)std::atan2(dir.y, dir.x) + (float)PI;
+			float force = (GRAVITY * body->GetMass() * body2->GetMass()) / dist;
+			b2Vec2 force_vect(std::cos(angle) * force, std::sin(angle) * force);
+
+			body->ApplyForceToCenter(force_vect, true);
+			body2->ApplyForceToCenter(-force_vect, true);
+		}
+
+		if (obj->player_id == 0)
+		{
+			b2Vec2 root_p(obj->root_position_x, obj->root_position_y);
+			b2Vec2 force_vect = root_p - p;
+			body->ApplyForceToCenter(force_vect, true);
+		}
+	}
+}
+
+void GameWorld::updateContinuousCollision(b2Body* body) const
+{
+	GameObject* obj = static_cast<GameObject*>(body->GetUserData());
+	if (obj == 0)
+		return;
+
+	// a body can only pass through something if it moves farther than its radius in one step,
+	// the level bounds are thicker than the smallest object
+	// note: fast bodies are not made bullets, that makes dense scenes orders of magnitude slower
+	float max_step = m_ccd_motion_ratio * (obj->radius + MIN_GAME_OBJECT_SIZE);
+	float step = body->GetLinearVelocity().Length() * WORLD_STEP;
+
+	body->SetContinuous(step > max_step);
+}
+
+void GameWorld::updateContinuousCollision()
+{
+	for (b2Body* body = m_world.GetBodyList(); body != 0; body = body->GetNext())
+	{
+		updateContinuousCollision(body);
+	}
+}
+
+void GameWorld::syncHighscore()
+{
+	PlayerManager* player_mgr = m_app->getPlayerManager();
+
+	// new players need the whole list, the rest only get what changed
+	bool full = player_mgr->getHighscoreChanges(m_highscore)
+		|| m_highscore_full_timer.peekElapsed() > HIGHSCORE_FULL_SYNC_RATE;
+
+	if (full)
+	{
+		player_mgr->getHighscore(m_highscore);
+		m_highscore_full_timer.reset();
+	}
+	else if (m_highscore.empty())
+	{
+		return;
+	}
+
+	Highscore e;
+	e.full = full;
+
+	for (size_t i = 0; i < m_highscore.size(); i += MAX_HIGHSCORE_ENTRIES_PER_SYNC)
+	{
+		size_t end = std::min(m_highscore.size(), i + MAX_HIGHSCORE_ENTRIES_PER_SYNC);
+		e.entries.assign(m_highscore.begin() + i, m_highscore.begin() + end);
+		m_app->handle(std::move(e), EventSource::GameWorld);
+		e.full = false; // only the first chunk clears the list
+	}
+}
+
 bool GameWorld::findNewObjectID(uint16_t player_id, uint16_t& object_id)
 {
-	if (player_id >= MAX_PLAYERS)
+	PlayerManager* player_mgr = m_app->getPlayerManager();
+	if (player_id >= player_mgr->getMaxPlayers())
 		return false;
 
-	auto free_slots = m_obj_slots[player_id].falsebits();
-	auto slot = free_slots.begin();
+	size_t max_objects = player_mgr->getMaxGameObjectsPerPlayer();
+	size_t used_slots = (player_id < m_obj_db.size()) ? m_obj_db[player_id].size() : 0;
 
-	if (slot == free_slots.end())
-		return false;
+	for (size_t slot = 0; slot < max_objects; ++slot)
+	{
+		if (slot >= used_slots || m_obj_db[player_id][slot] == nullptr)
+		{
+			object_id = (uint16_t)slot;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+GameObject* GameWorld::getGameObject(uint16_t player_id, uint16_t object_id) const
+{
+	if (player_id >= m_obj_db.size() || object_id >= m_obj_db[player_id].size())
+		return nullptr;
+
+	return m_obj_db[player_id][object_id];
+}
+
+void GameWorld::setGameObject(uint16_t player_id, uint16_t object_id, GameObject* obj)
+{
+	if (player_id >= m_obj_db.size())
+	{
+		if (obj == nullptr)
+			return;
+
+		m_obj_db.resize(player_id + 1);
+	}
+
+	auto& objects = m_obj_db[player_id];
+
+	if (object_id >= objects.size())
+	{
+		if (obj == nullptr)
+			return;
+
+		objects.resize(object_id + 1, nullptr);
+	}
 
-	object_id = (uint16_t)*slot;
-	return true;
+	objects[object_id] = obj;
 }
 
 GameObject* GameWorld::addGameObject(const AddGameObject& e)
@@ -365,11 +588,10 @@ GameObject* GameWorld::addGameObject(const AddGameObject& e, uint16_t object_id,
 	obj->value = 0;
 	obj->root_position_x = e.position_x;
 	obj->root_position_y = e.position_y;
-	obj->creation = std::chrono::steady_clock::now();
+	obj->creation = m_tick;
 	obj->expiry = obj->creation + getGameObjectDuration(radius);
 
-	m_obj_db[e.player_id][object_id] = obj;
-	m_obj_slots[e.player_id].set(object_id);
+	setGameObject(e.player_id, object_id, obj);
 
 	b2BodyDef def;
 	def.type = b2_dynamicBody;
@@ -392,18 +614,43 @@ GameObject* GameWorld::addGameObject(const AddGameObject& e, uint16_t object_id,
 	body->CreateFixture(&fixture);
 
 	body->SetLinearVelocity(b2Vec2(e.velocity_x, e.velocity_y));
+	updateContinuousCollision(body);
 
 	return obj;
 }
 
-void GameWorld::mergeGameObjects(GameObject* obj1, GameObject* obj2)
+unsigned GameWorld::mergeGameObjects()
+{
+	unsigned merges = 0;
+
+	// an object takes part in one merge per step, merged objects stay allocated
+	// until every candidate is resolved so their flag can still be checked
+	for (auto& candidate : m_merge_candidates)
+	{
+		if (candidate.first->merged || candidate.second->merged)
+			continue;
+
+		if (mergeGameObjects(candidate.first, candidate.second))
+			++merges;
+	}
+
+	for (GameObject* obj : m_merged)
+		delete obj;
+
+	m_merge_candidates.clear();
+	m_merged.clear();
+
+	return merges;
+}
+
+bool GameWorld::mergeGameObjects(GameObject* obj1, GameObject* obj2)
 {
 	if (!obj1 || !obj2)
-		return;
+		return false;
 
 	float radius = std::sqrt(obj1->radius * obj1->radius + obj2->radius * obj2->radius);
 	if (radius > MAX_GAME_OBJECT_SIZE)
-		return;
+		return false;
 
 	b2Body* body1 = obj1->body;
 	b2Body* body2 = obj2->body;
@@ -416,7 +663,7 @@ void GameWorld::mergeGameObjects(GameObject* obj1, GameObject* obj2)
 
 	if (velocity1.LengthSquared() < GAME_OBJECT_MERGE_VELOCITY_THRESHOLD
 		&& velocity2.LengthSquared() < GAME_OBJECT_MERGE_VELOCITY_THRESHOLD)
-		return;
+		return false;
 
 	float mass_fract = 1.f / (mass1 + mass2);
 	uint16_t player_id = 0;
@@ -451,8 +698,8 @@ void GameWorld::mergeGameObjects(GameObject* obj1, GameObject* obj2)
 
 	if (obj1->player_id == player_id || obj2->player_id == player_id)
 	{
-		removeGameObject(obj1->player_id, obj1->object_id);
-		removeGameObject(obj2->player_id, obj2->object_id);
+		retireGameObject(obj1);
+		retireGameObject(obj2);
 		objects_removed = true;
 	}
 
@@ -461,31 +708,40 @@ void GameWorld::mergeGameObjects(GameObject* obj1, GameObject* obj2)
 	{
 		if (!objects_removed)
 		{
-			removeGameObject(obj1->player_id, obj1->object_id);
-			removeGameObject(obj2->player_id, obj2->object_id);
+			retireGameObject(obj1);
+			retireGameObject(obj2);
 		}
 
-		new_obj->creation += std::chrono::milliseconds(GAME_SYNC_RATE * 2);
+		new_obj->creation += WORLD_TICKS(GAME_SYNC_RATE * 2);
 		new_obj->value = value;
+		return true;
 	}
+
+	return objects_removed;
 }
 
 void GameWorld::removeGameObject(uint16_t player_id, uint16_t object_id)
 {
-	if (player_id >= MAX_PLAYERS || object_id >= MAX_GAME_OBJECTS_PER_PLAYER)
-		return;
-
-	GameObject* obj = m_obj_db[player_id][object_id];
+	GameObject* obj = getGameObject(player_id, object_id);
 	if (!obj)
 		return;
 
-	m_obj_db[player_id][object_id] = nullptr;
-	m_obj_slots[player_id].unset(object_id);
+	setGameObject(player_id, object_id, nullptr);
 
 	m_world.DestroyBody(obj->body);
 	delete obj;
 }
 
+void GameWorld::retireGameObject(GameObject* obj)
+{
+	setGameObject(obj->player_id, obj->object_id, nullptr);
+
+	m_world.DestroyBody(obj->body);
+	obj->body = nullptr;
+	obj->merged = true;
+	m_merged.push_back(obj);
+}
+
 void GameWorld::removeUnsyncedGameObjects(uint32_t sync_id)
 {
 	for (b2Body* body = m_world.GetBodyList(); body != 0; )
@@ -504,8 +760,8 @@ void GameWorld::removeUnsyncedGameObjects(uint32_t sync_id)
 
 void GameWorld::removeExpiredGameObjects()
 {
-	bool ignore_expiry = m_app->getGameMode() == GameMode::Client;
-	auto now = std::chrono::steady_clock::now();
+	if (m_app->getGameMode() == GameMode::Client)
+		return; // the server expires the objects
 
 	for (b2Body* body = m_world.GetBodyList(); body != 0; )
 	{
@@ -514,7 +770,7 @@ void GameWorld::removeExpiredGameObjects()
 		GameObject* obj = static_cast<GameObject*>(body->GetUserData());
 		if (obj)
 		{
-			if (!ignore_expiry && obj->expiry < now)
+			if (obj->expiry < m_tick)
 			{
 				m_app->getPlayerManager()->addScore(obj->player_id, obj->value + GAME_OBJECT_EXPIRATION_BONUS);
 				removeGameObject(obj->player_id, obj->object_id);
@@ -527,10 +783,11 @@ void GameWorld::removeExpiredGameObjects()
 
 void GameWorld::sync(GameObjectState& state, uint32_t sync_id)
 {
-	if (state.player_id >= MAX_PLAYERS || state.object_id >= MAX_GAME_OBJECTS_PER_PLAYER)
+	PlayerManager* player_mgr = m_app->getPlayerManager();
+	if (state.player_id >= player_mgr->getMaxPlayers() || state.object_id >= player_mgr->getMaxGameObjectsPerPlayer())
 		return;
 
-	GameObject* obj = m_obj_db[state.player_id][state.object_id];
+	GameObject* obj = getGameObject(state.player_id, state.object_id);
 	if (obj)
 	{
 		obj->apply(state);
@@ -552,12 +809,46 @@ void GameWorld::sync(GameObjectState& state, uint32_t sync_id)
 
 void GameWorld::syncRenderer() const
 {
-	GameObjectSync render;
-	render.sync_id = ++m_render_counter;
-	render.object_count = 0;
-	render.target = GameObjectSync::Target::GameWindow;
+	PROFILE_ZONE("GameWorld::syncRenderer");
+
+	uint32_t sync_id = ++m_render_counter;
+
+	m_sync_batch.clear();
+	GameObjectSync* render = &addSync(sync_id, GameObjectSync::Target::GameWindow);
+
+	for (const b2Body* body = m_world.GetBodyList(); body != 0; body = body->GetNext())
+	{
+		GameObject* obj = static_cast<GameObject*>(body->GetUserData());
+		if (!obj)
+			continue;
+
+		if (render->object_count == MAX_GAME_OBJECTS_PER_SYNC)
+			render = &addSync(sync_id, GameObjectSync::Target::GameWindow);
+
+		obj->fill(render->object_states[render->object_count], m_tick);
+		++render->object_count;
+	}
+
+	m_app->handle(m_sync_batch, EventSource::GameWorld);
+}
+
+// the syncs of a round are collected in m_sync_batch and sent in one go
+GameObjectSync& GameWorld::addSync(uint32_t sync_id, GameObjectSync::Target target) const
+{
+	m_sync_batch.emplace_back();
 
-	unsigned render_events = 0;
+	GameObjectSync& sync = m_sync_batch.back();
+	sync.sync_id = sync_id;
+	sync.object_count = 0;
+	sync.target = target;
+	return sync;
+}
+
+void GameWorld::captureSnapshot(GameSnapshot& snapshot)
+{
+	PlayerManager* player_mgr = m_app->getPlayerManager();
+
+	snapshot.objects.clear();
 
 	for (const b2Body* body = m_world.GetBodyList(); body != 0; body = body->GetNext())
 	{
@@ -565,17 +856,370 @@ void GameWorld::syncRenderer() const
 		if (!obj)
 			continue;
 
-		obj->fill(render.object_states[render.object_count]);
-		++render.object_count;
+		GameObjectSnapshot object;
+		object.player_id = obj->player_id;
+		object.object_id = obj->object_id;
+		object.value = obj->value;
+		object.radius = obj->radius;
+		object.root_position_x = obj->root_position_x;
+		object.root_position_y = obj->root_position_y;
+		object.position_x = body->GetPosition().x;
+		object.position_y = body->GetPosition().y;
+		object.velocity_x = body->GetLinearVelocity().x;
+		object.velocity_y = body->GetLinearVelocity().y;
+		object.creation = (int32_t)((int64_t)obj->creation - (int64_t)m_tick);
+		object.expiry = (int32_t)((int64_t)obj->expiry - (int64_t)m_tick);
+		snapshot.objects.push_back(object);
+	}
+
+	snapshot.scores.clear();
+	player_mgr->getScores(snapshot.scores);
+
+	GameSnapshotHeader& header = snapshot.header;
+	header.magic = GameSnapshotHeader::MAGIC;
+	header.version = GameSnapshotHeader::VERSION;
+	header.max_players = player_mgr->getMaxPlayers();
+	header.max_game_objects_per_player = player_mgr->getMaxGameObjectsPerPlayer();
+	header.score_count = (uint32_t)snapshot.scores.size();
+	header.object_count = (uint32_t)snapshot.objects.size();
+}
+
+template<class Serializer>
+void GameWorld::writeSnapshot(Serializer& serializer, GameSnapshot& snapshot)
+{
+	serializer(snapshot.header);
+
+	for (auto& entry : snapshot.scores)
+		serializer(entry);
+
+	serializer(snapshot.objects.data(), snapshot.objects.size());
+}
+
+template<class Serializer>
+size_t GameWorld::readSnapshot(Serializer& serializer)
+{
+	GameSnapshotHeader header;
+	serializer(header);
+
+	if (header.magic != GameSnapshotHeader::MAGIC
+		|| header.version != GameSnapshotHeader::VERSION
+		|| header.score_count > header.max_players
+		|| header.object_count > (uint32_t)header.max_players * header.max_game_objects_per_player)
+	{
+		throw raz::SerializationError();
+	}
+
+	std::vector<HighscoreEntry>& scores = m_snapshot.scores;
+	scores.resize(header.score_count);
+	for (auto& entry : scores)
+		serializer(entry);
+
+	m_snapshot.objects.resize(header.object_count);
+	serializer(m_snapshot.objects.data(), m_snapshot.objects.size());
+
+	// the whole snapshot is read, only now is the current world thrown away
+	return restoreSnapshot(m_snapshot);
+}
+
+// the world is rebuilt from scratch, level bounds included, so the result doesn't depend on the world it replaces:
+// the body order, the broadphase proxy ids and the (empty) contact state only depend on the snapshot
+size_t GameWorld::restoreSnapshot(const GameSnapshot& snapshot)
+{
+	for (b2Body* body = m_world.GetBodyList(); body != 0; )
+	{
+		b2Body* next_body = body->GetNext();
+
+		GameObject* obj = static_cast<GameObject*>(body->GetUserData());
+		if (obj)
+			removeGameObject(obj->player_id, obj->object_id);
+		else
+			m_world.DestroyBody(body);
+
+		body = next_body;
+	}
+
+	setLevelBounds(WORLD_WIDTH, WORLD_HEIGHT);
+
+	PlayerManager* player_mgr = m_app->getPlayerManager();
+	uint16_t max_players = player_mgr->getMaxPlayers();
+	uint16_t max_game_objects_per_player = player_mgr->getMaxGameObjectsPerPlayer();
+	size_t restored = 0;
+
+	// the black objects of player 0 always stay, the ones of players not in use are dropped
+	std::vector<bool> in_use(max_players);
+	for (uint16_t player_id = 0; player_id < max_players; ++player_id)
+		in_use[player_id] = (player_id == 0 || player_mgr->getPlayer(player_id));
+
+	// objects that don't fit the current capacity are dropped
+	// b2World::CreateBody prepends, so the objects are added in reverse to keep the captured body order
+	for (auto it = snapshot.objects.rbegin(); it != snapshot.objects.rend(); ++it)
+	{
+		const GameObjectSnapshot& object = *it;
+
+		if (object.player_id >= max_players
+			|| object.object_id >= max_game_objects_per_player
+			|| !in_use[object.player_id]
+			|| getGameObject(object.player_id, object.object_id))
+		{
+			continue;
+		}
+
+		AddGameObject e;
+		e.player_id = object.player_id;
+		e.radius = object.radius;
+		e.position_x = object.position_x;
+		e.position_y = object.position_y;
+		e.velocity_x = object.velocity_x;
+		e.velocity_y = object.velocity_y;
+
+		GameObject* obj = addGameObject(e, object.object_id);
+		if (!obj)
+			continue;
+
+		obj->value = object.value;
+		obj->root_position_x = object.root_position_x;
+		obj->root_position_y = object.root_position_y;
+		obj->creation = addTicks(m_tick, object.creation);
+		obj->expiry = addTicks(m_tick, object.expiry);
+		++restored;
+	}
+
+	player_mgr->setScores(snapshot.scores);
+	return restored;
+}
+
+size_t GameWorld::saveSnapshot(const char* filename)
+{
+	waitForCheckpoint(); // it may be writing the same file
+	captureSnapshot(m_snapshot);
+	saveSnapshot(filename, m_snapshot);
+	return m_snapshot.objects.size();
+}
+
+void GameWorld::saveSnapshot(const char* filename, GameSnapshot& snapshot)
+{
+	// written aside and swapped in, so a failed save leaves the previous snapshot intact
+	std::string tmp_filename = std::string(filename) + ".tmp";
+	{
+		raz::MappedFile<> file(tmp_filename.c_str(), raz::SerializationMode::SERIALIZE);
+		writeSnapshot(file, snapshot);
+
+		// the data has to be on disk before the rename, or a crash could swap in an empty file
+		if (!file.close())
+			throw raz::MappedFileError();
+	}
+
+	if (!raz::replaceFile(tmp_filename.c_str(), filename))
+		throw raz::MappedFileError();
+}
+
+size_t GameWorld::loadSnapshot(const char* filename)
+{
+	waitForCheckpoint();
+	raz::MappedFile<> file(filename, raz::SerializationMode::DESERIALIZE);
+	return readSnapshot(file);
+}
+
+// only the capture runs on the world thread, the file is written in the background
+void GameWorld::startCheckpoint()
+{
+	captureSnapshot(m_checkpoint);
+
+	m_checkpoint_write = std::async(std::launch::async, [this]
+	{
+		saveSnapshot(SNAPSHOT_FILE, m_checkpoint);
+	});
+}
+
+void GameWorld::finishCheckpoint()
+{
+	if (!m_checkpoint_write.valid()
+		|| m_checkpoint_write.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+
+	try
+	{
+		m_checkpoint_write.get();
+	}
+	catch (std::exception&)
+	{
+		sendMessage("Cannot checkpoint the world to " SNAPSHOT_FILE);
+	}
+}
+
+void GameWorld::waitForCheckpoint()
+{
+	if (m_checkpoint_write.valid())
+		m_checkpoint_write.wait();
+
+	finishCheckpoint();
+}
+
+void GameWorld::startRecording(const char* filename)
+{
+	PlayerManager* player_mgr = m_app->getPlayerManager();
+
+	try
+	{
+		m_input_log.reset(new InputLogWriter(filename, player_mgr->getMaxPlayers(), player_mgr->getMaxGameObjectsPerPlayer()));
+	}
+	catch (std::exception&)
+	{
+		sendMessage("Cannot record the input log to " INPUT_LOG_FILE);
+		return;
+	}
+
+	// the players already in the session join first, then the snapshot gives their scores back
+	std::vector<HighscoreEntry> scores;
+	player_mgr->getScores(scores);
+
+	for (auto& entry : scores)
+	{
+		Connected e;
+		e.player_id = entry.player_id;
+		e.max_players = player_mgr->getMaxPlayers();
+		e.max_game_objects_per_player = player_mgr->getMaxGameObjectsPerPlayer();
+		record(InputLogEntry::Join, e);
+	}
+
+	recordSnapshot();
+}
+
+void GameWorld::recordSnapshot()
+{
+	if (!m_input_log)
+		return;
+
+	try
+	{
+		captureSnapshot(m_snapshot);
+		writeSnapshot(m_input_log->write(m_tick, InputLogEntry::Snapshot), m_snapshot);
+
+		// the live world continues from the snapshot too, so it doesn't keep contact state that a replay won't have
+		restoreSnapshot(m_snapshot);
+	}
+	catch (std::exception&)
+	{
+		m_input_log.reset();
+		sendMessage("Input log stopped, cannot write " INPUT_LOG_FILE);
+	}
+}
+
+// the full log is kept as a backup and a new, self-contained one is started in its place
+void GameWorld::rotateInputLog()
+{
+	m_input_log.reset();
+
+	if (!raz::replaceFile(INPUT_LOG_FILE, INPUT_LOG_FILE ".1"))
+	{
+		sendMessage("Input log stopped, cannot rotate " INPUT_LOG_FILE);
+		return;
+	}
+
+	startRecording(INPUT_LOG_FILE);
+}
+
+template<class Event>
+void GameWorld::record(InputLogEntry type, Event& e)
+{
+	if (!m_input_log)
+		return;
+
+	// rotated before the entry, so the new log starts with the world this event applies to
+	if (m_input_log->getSize() > INPUT_LOG_MAX_SIZE)
+	{
+		rotateInputLog();
+		if (!m_input_log)
+			return;
+	}
+
+	try
+	{
+		m_input_log->write(m_tick, type)(e);
+	}
+	catch (std::exception&)
+	{
+		m_input_log.reset();
+		sendMessage("Input log stopped, cannot write " INPUT_LOG_FILE);
+	}
+}
+
+bool GameWorld::replay(InputLogReader& log)
+{
+	PlayerManager* player_mgr = m_app->getPlayerManager();
+
+	for (; !log.isEnd() && log.getTick() <= m_tick; log.next())
+	{
+		auto& file = log.getFile();
 
-		if (render.object_count == MAX_GAME_OBJECTS_PER_SYNC)
+		switch (log.getType())
 		{
-			m_app->handle(render, EventSource::GameWorld);
-			render.object_count = 0;
-			++render_events;
+		case InputLogEntry::Snapshot:
+			readSnapshot(file);
+			break;
+
+		case InputLogEntry::Join:
+			{
+				Connected e;
+				file(e);
+				player_mgr->addPlayer(e.player_id);
+			}
+			break;
+
+		case InputLogEntry::Leave:
+			{
+				RemovePlayerGameObjects e;
+				file(e);
+				(*this)(e);
+				player_mgr->removePlayer(e.player_id);
+			}
+			break;
+
+		case InputLogEntry::AddGameObject:
+			{
+				AddGameObject e;
+				file(e);
+				(*this)(e);
+			}
+			break;
+
+		case InputLogEntry::RemoveGameObject:
+			{
+				RemoveGameObject e;
+				file(e);
+				(*this)(e);
+			}
+			break;
+
+		case InputLogEntry::RemoveGameObjectsNearMouse:
+			{
+				RemoveGameObjectsNearMouse e;
+				file(e);
+				(*this)(e);
+			}
+			break;
+
+		case InputLogEntry::SwitchPlayer:
+			{
+				SwitchPlayer e;
+				file(e);
+				if (player_mgr->switchPlayer(e.player_id, e.new_player_id))
+					(*this)(e);
+			}
+			break;
+
+		default:
+			throw raz::SerializationError();
 		}
 	}
 
-	if (render.object_count > 0 || render_events == 0)
-		m_app->handle(render, EventSource::GameWorld);
+	return !log.isEnd();
+}
+
+void GameWorld::sendMessage(const char* msg)
+{
+	Message e;
+	e.player_id = 0;
+	e.message.assign(msg, msg + std::strlen(msg));
+	m_app->handle(std::move(e), EventSource::GameWorld);
 }
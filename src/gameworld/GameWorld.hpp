@@ -20,50 +20,118 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #include <cstdint>
 #include <exception>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <utility>
+#include <vector>
 #include <Box2D/Box2D.h>
-#include <raz/bitset.hpp>
 #include <raz/timer.hpp>
 #include "common/IApplication.hpp"
 #include "gameworld/GameObject.hpp"
+#include "gameworld/GameSnapshot.hpp"
+
+enum class InputLogEntry : uint8_t;
+class InputLogWriter;
+class InputLogReader;
 
 class GameWorld : public b2ContactListener
 {
 public:
+	// how long the phases of a step took, filled in by step() when asked for
+	struct StepProfile
+	{
+		double gravity_ms;
+		double step_ms;
+		double broadphase_ms; // part of step_ms
+		double toi_ms; // part of step_ms
+		double merge_ms;
+		double expire_ms;
+	};
+
 	GameWorld(IApplication* app);
 	~GameWorld();
 	void operator()(); // loop
+	void operator()(Connected e);
 	void operator()(AddGameObject e);
-	void operator()(MergeGameObjects e);
 	void operator()(RemoveGameObjectsNearMouse e);
 	void operator()(RemoveGameObject e);
 	void operator()(RemovePlayerGameObjects e);
 	void operator()(GameObjectSync e);
 	void operator()(GameObjectSyncRequest);
 	void operator()(SwitchPlayer e);
+	void operator()(SaveSnapshot e);
+	void operator()(LoadSnapshot e);
 	void operator()(std::exception& e);
 
 	virtual void BeginContact(b2Contact *contact);
 
+	// applies the entries of a recorded input log up to the current tick, returns false once the log is over
+	bool replay(InputLogReader& log);
+
+	// advances the world by one fixed step, returns the number of merges
+	unsigned step(StepProfile* profile = nullptr);
+	void setStepParameters(float broadphase_rebuild_threshold, int solver_threads, float ccd_motion_ratio);
+
 private:
+	friend class GameWorldBenchmark;
+
 	IApplication* m_app;
 	raz::Timer m_timer;
 	raz::Timer m_highscore_timer;
+	raz::Timer m_highscore_full_timer;
+	raz::Timer m_snapshot_timer;
+	std::vector<HighscoreEntry> m_highscore;
 	float m_step_time;
+	float m_ccd_motion_ratio;
 	b2World m_world;
-	GameObject* m_obj_db[MAX_PLAYERS][MAX_GAME_OBJECTS_PER_PLAYER];
-	raz::Bitset<MAX_GAME_OBJECTS_PER_PLAYER> m_obj_slots[MAX_PLAYERS];
+	std::vector<std::vector<GameObject*>> m_obj_db; // [player_id][object_id], grows up to the capacity in PlayerManager
+	std::vector<std::pair<GameObject*, GameObject*>> m_merge_candidates; // collected by BeginContact during a step
+	std::vector<GameObject*> m_merged; // objects merged away in the current step, deleted after the merges
 	uint32_t m_last_sync_id;
 	mutable uint32_t m_render_counter;
+	mutable std::vector<GameObjectSync> m_sync_batch;
+	GameSnapshot m_snapshot; // reused by captureSnapshot, readSnapshot and recordSnapshot
+	GameSnapshot m_checkpoint; // owned by m_checkpoint_write while it runs
+	std::future<void> m_checkpoint_write;
+	uint64_t m_tick; // fixed steps taken
+	std::unique_ptr<InputLogWriter> m_input_log;
 
 	void setLevelBounds(float width, float height);
+	void syncHighscore();
+	void applyGravity();
+	void updateContinuousCollision(b2Body* body) const;
+	void updateContinuousCollision();
 	bool findNewObjectID(uint16_t player_id, uint16_t& object_id);
+	GameObject* getGameObject(uint16_t player_id, uint16_t object_id) const;
+	void setGameObject(uint16_t player_id, uint16_t object_id, GameObject* obj);
 	GameObject* addGameObject(const AddGameObject& e);
 	GameObject* addGameObject(const AddGameObject& e, uint16_t object_id, uint32_t sync_id = 0);
-	void mergeGameObjects(GameObject* obj1, GameObject* obj2);
+	unsigned mergeGameObjects(); // resolves m_merge_candidates, returns the number of merges
+	bool mergeGameObjects(GameObject* obj1, GameObject* obj2);
 	void removeGameObject(uint16_t player_id, uint16_t object_id);
+	void retireGameObject(GameObject* obj); // removes the object from the world but keeps it allocated until the merges are done
 	void removeUnsyncedGameObjects(uint32_t sync_id);
 	void removeExpiredGameObjects();
 	void sync(GameObjectState& state, uint32_t sync_id);
 	void syncRenderer() const;
+	GameObjectSync& addSync(uint32_t sync_id, GameObjectSync::Target target) const;
+	size_t saveSnapshot(const char* filename); // these return the number of game objects and throw on failure
+	size_t loadSnapshot(const char* filename);
+	void captureSnapshot(GameSnapshot& snapshot);
+	static void saveSnapshot(const char* filename, GameSnapshot& snapshot);
+	template<class Serializer>
+	static void writeSnapshot(Serializer& serializer, GameSnapshot& snapshot);
+	template<class Serializer>
+	size_t readSnapshot(Serializer& serializer);
+	size_t restoreSnapshot(const GameSnapshot& snapshot); // replaces the world, returns the number of game objects
+	void startCheckpoint();
+	void finishCheckpoint(); // reports a failed checkpoint once it is written
+	void waitForCheckpoint(); // before touching the snapshot files on the world thread
+	void startRecording(const char* filename);
+	void rotateInputLog();
+	void recordSnapshot();
+	template<class Event>
+	void record(InputLogEntry type, Event& e);
+	void sendMessage(const char* msg);
 };
@@ -0,0 +1,120 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#include <raz/hash.hpp>
+#include "gameworld/InputLog.hpp"
+
+static constexpr uint32_t INPUT_LOG_MAGIC = (uint32_t)raz::hash("RazzGravitasInputLog");
+static constexpr uint32_t INPUT_LOG_VERSION = 1;
+
+InputLogWriter::InputLogWriter(const char* filename, uint16_t max_players, uint16_t max_game_objects_per_player) :
+	m_file(filename, raz::SerializationMode::SERIALIZE),
+	m_tick(0)
+{
+	uint32_t magic = INPUT_LOG_MAGIC;
+	uint32_t version = INPUT_LOG_VERSION;
+	m_file(magic)(version)(max_players)(max_game_objects_per_player);
+}
+
+InputLogWriter::~InputLogWriter()
+{
+	try
+	{
+		write(m_tick, InputLogEntry::End);
+	}
+	catch (std::exception&)
+	{
+	}
+}
+
+raz::MappedFile<>& InputLogWriter::write(uint64_t tick, InputLogEntry type)
+{
+	uint64_t delta = tick - m_tick;
+	uint8_t _type = (uint8_t)type;
+	m_file(raz::varint(delta))(_type);
+
+	m_tick = tick;
+	return m_file;
+}
+
+size_t InputLogWriter::getSize() const
+{
+	return m_file.getSize();
+}
+
+InputLogReader::InputLogReader(const char* filename) :
+	m_file(filename, raz::SerializationMode::DESERIALIZE),
+	m_tick(0),
+	m_type(InputLogEntry::End)
+{
+	uint32_t magic;
+	uint32_t version;
+	m_file(magic)(version)(m_max_players)(m_max_game_objects_per_player);
+
+	if (magic != INPUT_LOG_MAGIC || version != INPUT_LOG_VERSION)
+		throw raz::SerializationError();
+
+	next();
+}
+
+uint16_t InputLogReader::getMaxPlayers() const
+{
+	return m_max_players;
+}
+
+uint16_t InputLogReader::getMaxGameObjectsPerPlayer() const
+{
+	return m_max_game_objects_per_player;
+}
+
+bool InputLogReader::isEnd() const
+{
+	return (m_type == InputLogEntry::End);
+}
+
+uint64_t InputLogReader::getTick() const
+{
+	return m_tick;
+}
+
+InputLogEntry InputLogReader::getType() const
+{
+	return m_type;
+}
+
+raz::MappedFile<>& InputLogReader::getFile()
+{
+	return m_file;
+}
+
+void InputLogReader::next()
+{
+	try
+	{
+		uint64_t delta;
+		uint8_t type;
+		m_file(raz::varint(delta))(type);
+
+		m_tick += delta;
+		m_type = (InputLogEntry)type;
+	}
+	catch (raz::SerializationError&)
+	{
+		m_type = InputLogEntry::End; // cut off in the middle of an entry
+	}
+}
@@ -0,0 +1,78 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <raz/mappedfile.hpp>
+
+enum class InputLogEntry : uint8_t
+{
+	End, // the unused tail of a log that wasn't closed reads as this too
+	Snapshot,
+	Join,
+	Leave,
+	AddGameObject,
+	RemoveGameObject,
+	RemoveGameObjectsNearMouse,
+	SwitchPlayer
+};
+
+/*
+Append-only log of the inbound events of a host session. An entry is the varint delta
+of the world tick it got applied at, its type, then the payload. A log starts with the
+players in use and a snapshot of the world, so a replay doesn't need anything else.
+The host reloads its world from every snapshot it records, so the replay starts from the
+same state even though a snapshot doesn't carry the contact state of Box2D.
+*/
+class InputLogWriter
+{
+public:
+	InputLogWriter(const char* filename, uint16_t max_players, uint16_t max_game_objects_per_player);
+	~InputLogWriter();
+
+	// writes the head of an entry, the payload goes to the returned serializer
+	raz::MappedFile<>& write(uint64_t tick, InputLogEntry type);
+	size_t getSize() const;
+
+private:
+	raz::MappedFile<> m_file;
+	uint64_t m_tick;
+};
+
+class InputLogReader
+{
+public:
+	InputLogReader(const char* filename);
+	uint16_t getMaxPlayers() const;
+	uint16_t getMaxGameObjectsPerPlayer() const;
+	bool isEnd() const;
+	uint64_t getTick() const;
+	InputLogEntry getType() const;
+
+	// the payload of the current entry is read from here, then next() moves on
+	raz::MappedFile<>& getFile();
+	void next();
+
+private:
+	raz::MappedFile<> m_file;
+	uint16_t m_max_players;
+	uint16_t m_max_game_objects_per_player;
+	uint64_t m_tick;
+	InputLogEntry m_type;
+};
@@ -0,0 +1,344 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#include <algorithm>
+#include "loadgen/LoadBot.hpp"
+
+void LoadStats::merge(const LoadStats& other)
+{
+	spawns_sent += other.spawns_sent;
+	spawns_lost += other.spawns_lost;
+	removes_sent += other.removes_sent;
+	sync_packets += other.sync_packets;
+	sync_bytes += other.sync_bytes;
+	sync_rounds += other.sync_rounds;
+	incomplete_sync_rounds += other.incomplete_sync_rounds;
+	sync_intervals.insert(sync_intervals.end(), other.sync_intervals.begin(), other.sync_intervals.end());
+	spawn_latencies.insert(spawn_latencies.end(), other.spawn_latencies.begin(), other.spawn_latencies.end());
+}
+
+LoadBot::LoadBot(const char* host, const LoadScript& script, uint64_t seed) :
+	m_host(host),
+	m_script(script),
+	m_player(nullptr),
+	m_random(seed),
+	m_failed(false),
+	m_sync_id(0),
+	m_round_object_count(0),
+	m_last_round_object_count(0),
+	m_round_complete(true)
+{
+}
+
+LoadBot::~LoadBot()
+{
+	stop();
+}
+
+void LoadBot::start()
+{
+	m_client.start(this, m_host.c_str());
+}
+
+void LoadBot::stop()
+{
+	m_client.stop();
+}
+
+void LoadBot::update()
+{
+	const Player* player = m_player.load(std::memory_order_acquire);
+	if (!player || isFailed())
+		return;
+
+	if (m_spawn_timer.peekElapsed() < m_script.spawn_interval)
+		return;
+
+	m_spawn_timer.reset();
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	// spawns that didn't show up in time were dropped somewhere
+	auto spawn_timeout = std::chrono::steady_clock::now() - std::chrono::milliseconds(CONNECTION_TIMEOUT);
+	while (!m_pending_spawns.empty() && m_pending_spawns.front() < spawn_timeout)
+	{
+		m_pending_spawns.pop_front();
+		++m_stats.spawns_lost;
+	}
+
+	size_t objects = std::count(m_objects.begin(), m_objects.end(), true) + m_pending_spawns.size();
+
+	switch (m_script.pattern)
+	{
+	case LoadScript::Steady:
+		if (objects >= m_script.max_objects)
+			removeObject(player->player_id);
+		spawnObject(player->player_id);
+		break;
+
+	case LoadScript::Burst:
+		if (objects >= m_script.max_objects)
+		{
+			while (removeObject(player->player_id));
+		}
+		else
+		{
+			for (uint32_t i = 0; i < m_script.burst_size && objects + i < m_script.max_objects; ++i)
+				spawnObject(player->player_id);
+		}
+		break;
+
+	case LoadScript::Churn:
+		while (removeObject(player->player_id));
+		spawnObject(player->player_id);
+		break;
+	}
+}
+
+bool LoadBot::isConnected() const
+{
+	return (m_player.load(std::memory_order_acquire) != nullptr);
+}
+
+bool LoadBot::isFailed() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_failed;
+}
+
+std::string LoadBot::getFailReason() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_fail_reason;
+}
+
+LoadStats LoadBot::getStats() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_stats;
+}
+
+GameMode LoadBot::getGameMode() const
+{
+	return GameMode::Client;
+}
+
+PlayerManager* LoadBot::getPlayerManager()
+{
+	return &m_player_mgr;
+}
+
+void LoadBot::exit(int exit_code, const char* msg)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	if (!m_failed)
+	{
+		m_failed = true;
+		m_fail_reason = msg ? msg : "";
+	}
+}
+
+void LoadBot::handle(Connected e, EventSource src)
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_objects.assign(e.max_game_objects_per_player, false);
+		m_round_objects.assign(e.max_game_objects_per_player, false);
+		m_removed_objects.assign(e.max_game_objects_per_player, false);
+	}
+
+	m_player_mgr.setCapacity(e.max_players, e.max_game_objects_per_player);
+	m_player.store(m_player_mgr.addLocalPlayer(e.player_id), std::memory_order_release);
+}
+
+void LoadBot::handle(Disconnected e, EventSource src)
+{
+	switch (e.reason)
+	{
+	case Disconnected::ServerClosed:
+		exit(-1, "Server closed");
+		break;
+
+	case Disconnected::ServerFull:
+		exit(-1, "Server full");
+		break;
+
+	case Disconnected::Compatibility:
+		exit(-1, "This version is not compatible with the server");
+		break;
+	}
+}
+
+void LoadBot::handle(SwitchPlayer e, EventSource src)
+{
+}
+
+void LoadBot::handle(Message e, EventSource src)
+{
+}
+
+void LoadBot::handle(AddGameObject e, EventSource src)
+{
+}
+
+void LoadBot::handle(RemoveGameObjectsNearMouse e, EventSource src)
+{
+}
+
+void LoadBot::handle(RemoveGameObject e, EventSource src)
+{
+}
+
+void LoadBot::handle(RemovePlayerGameObjects e, EventSource src)
+{
+}
+
+void LoadBot::handle(GameObjectSync e, EventSource src)
+{
+	auto now = std::chrono::steady_clock::now();
+
+	// serializing the event again gives us the exact size it had on the wire
+	raz::Packet<MAX_PACKET_SIZE> packet;
+	packet.setType((raz::PacketType)EventType::GameObjectSync);
+	packet.setMode(raz::SerializationMode::SERIALIZE);
+	packet(e);
+
+	auto* pdata = packet.getPacketData();
+	size_t packet_size = sizeof(pdata->head) + pdata->head.packet_size + sizeof(pdata->tail);
+
+	const Player* player = m_player.load(std::memory_order_acquire);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	++m_stats.sync_packets;
+	m_stats.sync_bytes += packet_size;
+
+	if (e.sync_id != m_sync_id)
+	{
+		if (m_stats.sync_packets > 1)
+		{
+			finishSyncRound();
+			m_stats.sync_intervals.push_back(std::chrono::duration<double, std::milli>(now - m_round_start).count());
+		}
+
+		m_sync_id = e.sync_id;
+		m_round_start = now;
+		m_round_object_count = 0;
+		m_round_complete = false;
+		m_round_objects.assign(m_round_objects.size(), false);
+	}
+
+	m_round_object_count += e.object_count;
+
+	// the last chunk of a sync round is the only one that isn't full
+	if (e.object_count < MAX_GAME_OBJECTS_PER_SYNC)
+		m_round_complete = true;
+
+	if (!player)
+		return;
+
+	for (uint32_t i = 0; i < e.object_count; ++i)
+	{
+		const GameObjectState& state = e.object_states[i];
+		if (state.player_id != player->player_id || state.object_id >= m_objects.size())
+			continue;
+
+		if (!m_objects[state.object_id]
+			&& !m_round_objects[state.object_id]
+			&& !m_removed_objects[state.object_id]
+			&& !m_pending_spawns.empty())
+		{
+			m_stats.spawn_latencies.push_back(std::chrono::duration<double, std::milli>(now - m_pending_spawns.front()).count());
+			m_pending_spawns.pop_front();
+		}
+
+		m_round_objects[state.object_id] = true;
+	}
+}
+
+void LoadBot::handle(const std::vector<GameObjectSync>& batch, EventSource src)
+{
+	for (auto& e : batch)
+		handle(e, src);
+}
+
+void LoadBot::handle(GameObjectSyncRequest e, EventSource src)
+{
+}
+
+void LoadBot::handle(Highscore e, EventSource src)
+{
+}
+
+void LoadBot::spawnObject(uint16_t player_id)
+{
+	AddGameObject e;
+	e.player_id = player_id;
+	e.radius = m_random(MIN_GAME_OBJECT_SIZE, MAX_GAME_OBJECT_CREATION_SIZE);
+	e.position_x = m_random(0.f, (float)WORLD_WIDTH);
+	e.position_y = m_random(0.f, (float)WORLD_HEIGHT);
+	e.velocity_x = m_random(-5.f, 5.f);
+	e.velocity_y = m_random(-5.f, 5.f);
+
+	m_client(e);
+	m_pending_spawns.push_back(std::chrono::steady_clock::now());
+	++m_stats.spawns_sent;
+}
+
+bool LoadBot::removeObject(uint16_t player_id)
+{
+	auto it = std::find(m_objects.begin(), m_objects.end(), true);
+	if (it == m_objects.end())
+		return false;
+
+	RemoveGameObject e;
+	e.player_id = player_id;
+	e.object_id = (uint16_t)(it - m_objects.begin());
+
+	m_client(e);
+	m_objects[e.object_id] = false;
+	m_removed_objects[e.object_id] = true;
+	++m_stats.removes_sent;
+	return true;
+}
+
+void LoadBot::finishSyncRound()
+{
+	++m_stats.sync_rounds;
+
+	// a round without its closing chunk lost at least one packet,
+	// unless the object count happens to be a multiple of MAX_GAME_OBJECTS_PER_SYNC
+	if (!m_round_complete && m_round_object_count < m_last_round_object_count)
+		++m_stats.incomplete_sync_rounds;
+
+	m_last_round_object_count = m_round_object_count;
+	m_objects = m_round_objects;
+
+	// removed objects are forgotten once the server stops syncing them
+	for (size_t object_id = 0; object_id < m_removed_objects.size(); ++object_id)
+	{
+		if (!m_removed_objects[object_id])
+			continue;
+
+		if (m_round_objects[object_id])
+			m_objects[object_id] = false;
+		else
+			m_removed_objects[object_id] = false;
+	}
+}
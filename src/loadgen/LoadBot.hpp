@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <raz/random.hpp>
+#include <raz/thread.hpp>
+#include <raz/timer.hpp>
+#include "common/IApplication.hpp"
+#include "common/PlayerManager.hpp"
+#include "network/NetworkClient.hpp"
+
+struct LoadScript
+{
+	enum Pattern
+	{
+		Steady, // spawn one object per interval, remove one when at the limit
+		Burst,  // spawn burst_size objects per interval, remove all at the limit
+		Churn   // remove everything that got spawned, then spawn again
+	};
+
+	Pattern pattern;
+	uint32_t spawn_interval; // ms
+	uint32_t max_objects;
+	uint32_t burst_size;
+};
+
+struct LoadStats
+{
+	uint64_t spawns_sent = 0;
+	uint64_t spawns_lost = 0;
+	uint64_t removes_sent = 0;
+	uint64_t sync_packets = 0;
+	uint64_t sync_bytes = 0;
+	uint64_t sync_rounds = 0;
+	uint64_t incomplete_sync_rounds = 0;
+	std::vector<double> sync_intervals; // ms
+	std::vector<double> spawn_latencies; // ms
+
+	void merge(const LoadStats& other);
+};
+
+class LoadBot : public IApplication
+{
+public:
+	LoadBot(const char* host, const LoadScript& script, uint64_t seed);
+	~LoadBot();
+	void start();
+	void stop();
+	void update(); // runs the script, call it periodically
+	bool isConnected() const;
+	bool isFailed() const;
+	std::string getFailReason() const;
+	LoadStats getStats() const;
+
+	virtual GameMode getGameMode() const;
+	virtual PlayerManager* getPlayerManager();
+	virtual void exit(int exit_code, const char* msg = nullptr);
+	virtual void handle(Connected e, EventSource src);
+	virtual void handle(Disconnected e, EventSource src);
+	virtual void handle(SwitchPlayer e, EventSource src);
+	virtual void handle(Message e, EventSource src);
+	virtual void handle(AddGameObject e, EventSource src);
+	virtual void handle(RemoveGameObjectsNearMouse e, EventSource src);
+	virtual void handle(RemoveGameObject e, EventSource src);
+	virtual void handle(RemovePlayerGameObjects e, EventSource src);
+	virtual void handle(GameObjectSync e, EventSource src);
+	virtual void handle(const std::vector<GameObjectSync>& batch, EventSource src);
+	virtual void handle(GameObjectSyncRequest e, EventSource src);
+	virtual void handle(Highscore e, EventSource src);
+
+private:
+	typedef std::vector<bool> ObjectSlots; // sized to the object capacity of the server
+
+	std::string m_host;
+	LoadScript m_script;
+	PlayerManager m_player_mgr;
+	std::atomic<const Player*> m_player; // published by the network thread in handle(Connected)
+	raz::Random m_random;
+	raz::Timer m_spawn_timer;
+	mutable std::mutex m_mutex;
+	bool m_failed;
+	std::string m_fail_reason;
+	LoadStats m_stats;
+	std::deque<std::chrono::steady_clock::time_point> m_pending_spawns;
+	ObjectSlots m_objects;          // own objects seen in the last complete round
+	ObjectSlots m_round_objects;    // own objects seen in the current round
+	ObjectSlots m_removed_objects;  // own objects removed but possibly still synced
+	uint32_t m_sync_id;
+	uint32_t m_round_object_count;
+	uint32_t m_last_round_object_count;
+	bool m_round_complete;
+	std::chrono::steady_clock::time_point m_round_start;
+	raz::Thread<NetworkClient> m_client;
+
+	void spawnObject(uint16_t player_id);
+	bool removeObject(uint16_t player_id);
+	void finishSyncRound();
+};
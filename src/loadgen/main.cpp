@@ -0,0 +1,171 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "loadgen/LoadBot.hpp"
+
+/*
+ * Headless load generator: connects N bots to a running server (dedicated or
+ * a /host session) and drives them with a scripted spawn/removal pattern.
+ * Start several processes to spread the bots across processes.
+ *
+ * usage: razzgravitas-loadgen <host[:port]> [bots] [seconds] [steady|burst|churn] [spawn interval ms] [seed]
+ */
+
+static double percentile(std::vector<double>& values, double p)
+{
+	if (values.empty())
+		return 0.0;
+
+	size_t n = (size_t)(p * (values.size() - 1) + 0.5);
+	std::nth_element(values.begin(), values.begin() + n, values.end());
+	return values[n];
+}
+
+static double mean(const std::vector<double>& values)
+{
+	if (values.empty())
+		return 0.0;
+
+	double sum = 0.0;
+	for (double v : values)
+		sum += v;
+
+	return sum / values.size();
+}
+
+static double stddev(const std::vector<double>& values)
+{
+	if (values.size() < 2)
+		return 0.0;
+
+	double m = mean(values);
+	double sum = 0.0;
+	for (double v : values)
+		sum += (v - m) * (v - m);
+
+	return std::sqrt(sum / (values.size() - 1));
+}
+
+static bool parsePattern(const char* str, LoadScript::Pattern& pattern)
+{
+	if (std::strcmp(str, "steady") == 0)
+		pattern = LoadScript::Steady;
+	else if (std::strcmp(str, "burst") == 0)
+		pattern = LoadScript::Burst;
+	else if (std::strcmp(str, "churn") == 0)
+		pattern = LoadScript::Churn;
+	else
+		return false;
+
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::printf("usage: %s <host[:port]> [bots] [seconds] [steady|burst|churn] [spawn interval ms] [seed]\n", argv[0]);
+		return 1;
+	}
+
+	const char* host = argv[1];
+	unsigned bots = (argc > 2) ? (unsigned)std::stoul(argv[2]) : (DEFAULT_MAX_PLAYERS - 1);
+	unsigned seconds = (argc > 3) ? (unsigned)std::stoul(argv[3]) : 30;
+	uint64_t seed = (argc > 6) ? std::stoull(argv[6]) : 1;
+
+	LoadScript script;
+	script.pattern = LoadScript::Steady;
+	script.spawn_interval = (argc > 5) ? (uint32_t)std::stoul(argv[5]) : 250;
+	script.max_objects = DEFAULT_MAX_GAME_OBJECTS_PER_PLAYER / 2;
+	script.burst_size = 4;
+
+	if (argc > 4 && !parsePattern(argv[4], script.pattern))
+	{
+		std::printf("unknown pattern: %s\n", argv[4]);
+		return 1;
+	}
+
+	std::vector<std::unique_ptr<LoadBot>> load_bots;
+	for (unsigned i = 0; i < bots; ++i)
+	{
+		load_bots.emplace_back(new LoadBot(host, script, seed + i));
+		load_bots.back()->start();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10)); // don't flood the server with Hellos
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	auto end = start + std::chrono::seconds(seconds);
+
+	while (std::chrono::steady_clock::now() < end)
+	{
+		for (auto& bot : load_bots)
+			bot->update();
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	double duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	LoadStats stats;
+	unsigned connected = 0;
+	unsigned failed = 0;
+
+	for (auto& bot : load_bots)
+	{
+		bot->stop();
+
+		if (bot->isConnected())
+			++connected;
+
+		if (bot->isFailed())
+		{
+			++failed;
+			std::printf("# bot failed: %s\n", bot->getFailReason().c_str());
+		}
+
+		stats.merge(bot->getStats());
+	}
+
+	double sync_kbps = (stats.sync_bytes * 8 / 1000.0) / duration;
+	double sync_loss = stats.sync_rounds ? (100.0 * stats.incomplete_sync_rounds / stats.sync_rounds) : 0.0;
+
+	std::printf("bots=%u connected=%u failed=%u duration_s=%.1f\n", bots, connected, failed, duration);
+	std::printf("spawns_sent=%llu spawns_lost=%llu removes_sent=%llu\n",
+		(unsigned long long)stats.spawns_sent, (unsigned long long)stats.spawns_lost, (unsigned long long)stats.removes_sent);
+	std::printf("server_tick_ms mean=%.2f p50=%.2f p99=%.2f jitter=%.2f\n",
+		mean(stats.sync_intervals), percentile(stats.sync_intervals, 0.5), percentile(stats.sync_intervals, 0.99), stddev(stats.sync_intervals));
+	std::printf("sync_bandwidth_kbps total=%.1f per_bot=%.1f packets=%llu\n",
+		sync_kbps, connected ? (sync_kbps / connected) : 0.0, (unsigned long long)stats.sync_packets);
+	std::printf("sync_loss_pct=%.2f rounds=%llu incomplete=%llu\n",
+		sync_loss, (unsigned long long)stats.sync_rounds, (unsigned long long)stats.incomplete_sync_rounds);
+	std::printf("spawn_latency_ms n=%zu p50=%.2f p90=%.2f p99=%.2f max=%.2f\n",
+		stats.spawn_latencies.size(),
+		percentile(stats.spawn_latencies, 0.5), percentile(stats.spawn_latencies, 0.9),
+		percentile(stats.spawn_latencies, 0.99), percentile(stats.spawn_latencies, 1.0));
+
+	return (failed == 0) ? 0 : 2;
+}
@@ -17,11 +17,15 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 */
 
 #include "common/PlayerManager.hpp"
+#include "common/Profiler.hpp"
 #include "network/NetworkClient.hpp"
 
 NetworkClient::NetworkClient(IApplication* app, const char* cmdline) :
-	m_app(app)
+	m_app(app),
+	m_session_token(0)
 {
+	Profiler::setThreadName("NetworkClient");
+
 	char host[256];
 	std::memcpy(host, cmdline, strlen(cmdline) + 1);
 
@@ -35,17 +39,12 @@ NetworkClient::NetworkClient(IApplication* app, const char* cmdline) :
 
 	if (m_client.getBackend().open(host, port))
 	{
-		Hello e;
-		e.build_hash = Hello::unique_build_hash();
-
-		Packet packet;
-		packet.setType((raz::PacketType)EventType::Hello);
-		packet.setMode(raz::SerializationMode::SERIALIZE);
-		packet(e);
+		m_client.getBackend().getReactor().setTimer(PING_RATE);
+		m_hello.build_hash = Hello::unique_build_hash();
 
 		try
 		{
-			m_client.send(packet);
+			sendHello();
 			return;
 		}
 		catch (raz::NetworkSocketError&)
@@ -73,29 +72,38 @@ void NetworkClient::operator()()
 		return;
 	}
 
-	const Player* player = m_app->getPlayerManager()->getLocalPlayer();
-	if (player)
+	Packet packet;
+	if (m_client.receive(packet, GAME_SYNC_RATE))
 	{
-		uint64_t timeout =
-			std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - player->last_updated).count();
+		bool handled = m_channel.receive(packet) && handlePacket(packet);
 
-		if (timeout >= PING_RATE)
-		{
-			player->last_updated = std::chrono::steady_clock::now();
+		// reliable packets that arrived early and were waiting for this one
+		while (m_channel.popReady(packet))
+			handled = handlePacket(packet) || handled;
 
-			Packet packet;
-			packet.setType((raz::PacketType)EventType::Ping);
-			m_client.send(packet);
-		}
+		if (handled)
+			m_timeout.reset();
 	}
 
-	Packet packet;
-	if (!m_client.receive(packet, GAME_SYNC_RATE))
-		return;
+	if (m_client.getBackend().getReactor().consumeTimer())
+	{
+		if (!m_session_token)
+		{
+			sendHello(); // either the Hello or the Challenge got lost
+		}
+		else if (m_app->getPlayerManager()->getLocalPlayer())
+		{
+			Packet ping;
+			ping.setType((raz::PacketType)EventType::Ping);
+			send(ping, false);
+		}
+	}
 
-	packet.setMode(raz::SerializationMode::DESERIALIZE);
-	if (handlePacket(packet))
-		m_timeout.reset();
+	m_channel.update([this](Packet& packet)
+	{
+		packet.getPacketData()->head.session_token = m_session_token;
+		m_client.send(packet);
+	});
 }
 
 void NetworkClient::operator()(Message e)
@@ -105,7 +113,7 @@ void NetworkClient::operator()(Message e)
 	packet.setMode(raz::SerializationMode::SERIALIZE);
 	packet(e);
 
-	m_client.send(packet);
+	send(packet, true);
 }
 
 void NetworkClient::operator()(AddGameObject e)
@@ -115,7 +123,7 @@ void NetworkClient::operator()(AddGameObject e)
 	packet.setMode(raz::SerializationMode::SERIALIZE);
 	packet(e);
 
-	m_client.send(packet);
+	send(packet, true);
 }
 
 void NetworkClient::operator()(RemoveGameObject e)
@@ -125,7 +133,7 @@ void NetworkClient::operator()(RemoveGameObject e)
 	packet.setMode(raz::SerializationMode::SERIALIZE);
 	packet(e);
 
-	m_client.send(packet);
+	send(packet, true);
 }
 
 void NetworkClient::operator()(SwitchPlayer e)
@@ -135,7 +143,7 @@ void NetworkClient::operator()(SwitchPlayer e)
 	packet.setMode(raz::SerializationMode::SERIALIZE);
 	packet(e);
 
-	m_client.send(packet);
+	send(packet, true);
 }
 
 void NetworkClient::operator()(std::exception& e)
@@ -143,9 +151,59 @@ void NetworkClient::operator()(std::exception& e)
 	m_app->exit(-1, e.what());
 }
 
+void NetworkClient::wakeUp()
+{
+	m_client.getBackend().getReactor().wakeUp();
+}
+
+void NetworkClient::send(Packet& packet, bool reliable)
+{
+	m_channel.send(packet, reliable, [this](Packet& packet)
+	{
+		packet.getPacketData()->head.session_token = m_session_token;
+		m_client.send(packet);
+	});
+}
+
+void NetworkClient::sendHello()
+{
+	Packet packet;
+	packet.setType((raz::PacketType)EventType::Hello);
+	packet.setMode(raz::SerializationMode::SERIALIZE);
+	packet(m_hello);
+
+	send(packet, false);
+}
+
+bool NetworkClient::handleChallenge(Packet& packet)
+{
+	if (packet.getType() != (raz::PacketType)EventType::Challenge)
+		return false;
+
+	Challenge e;
+	packet(e);
+
+	if (m_session_token)
+		return true; // a late duplicate, we are already connected
+
+	// prove that we own our address by echoing the cookie
+	m_hello.cookie = e.cookie;
+	m_hello.cookie_time = e.cookie_time;
+	sendHello();
+	return true;
+}
+
 bool NetworkClient::handlePacket(Packet& packet)
 {
-	return (tryHandle<Connected>(packet)
+	PROFILE_ZONE("NetworkClient::handlePacket");
+
+	packet.setMode(raz::SerializationMode::DESERIALIZE);
+
+	if (packet.getType() == (raz::PacketType)EventType::Connected)
+		m_session_token = packet.getPacketData()->head.session_token;
+
+	return (handleChallenge(packet)
+		|| tryHandle<Connected>(packet)
 		|| tryHandle<Disconnected>(packet)
 		|| tryHandle<SwitchPlayer>(packet)
 		|| tryHandle<Message>(packet)
@@ -34,6 +34,7 @@ public:
 	void operator()(RemoveGameObject e);
 	void operator()(SwitchPlayer e);
 	void operator()(std::exception& e);
+	void wakeUp(); // thread-safe
 
 private:
 	typedef raz::Packet<MAX_PACKET_SIZE> Packet;
@@ -41,8 +42,14 @@ private:
 	raz::NetworkInitializer m_init;
 	IApplication* m_app;
 	raz::NetworkClientUDP<MAX_PACKET_SIZE> m_client;
+	raz::ReliableChannel<MAX_PACKET_SIZE> m_channel;
 	raz::Timer m_timeout;
+	Hello m_hello;
+	uint64_t m_session_token;
 
+	void send(Packet& packet, bool reliable);
+	void sendHello();
+	bool handleChallenge(Packet& packet);
 	bool handlePacket(Packet& packet);
 
 	template<class Event>
@@ -54,7 +61,7 @@ private:
 			packet.setMode(raz::SerializationMode::DESERIALIZE);
 			packet(e);
 
-			m_app->handle(e, EventSource::Network);
+			m_app->handle(std::move(e), EventSource::Network);
 			return true;
 		}
 
@@ -0,0 +1,161 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include "network/NetworkSender.hpp"
+
+NetworkSender::NetworkSender(Backend& backend) :
+	m_backend(&backend),
+	m_slots(SEND_QUEUE_SIZE),
+	m_head(0),
+	m_tail(0),
+	m_dropped(0),
+	m_running(true),
+	m_idle(false)
+{
+	static_assert((SEND_QUEUE_SIZE & (SEND_QUEUE_SIZE - 1)) == 0, "SEND_QUEUE_SIZE should be a power of 2");
+
+	m_thread = std::thread(&NetworkSender::run, this);
+}
+
+NetworkSender::~NetworkSender()
+{
+	stop();
+}
+
+size_t NetworkSender::write(const Client& client, const char* ptr, size_t len)
+{
+	size_t tail = m_tail.load(std::memory_order_relaxed);
+	size_t head = m_head.load(std::memory_order_acquire);
+
+	if (tail - head >= SEND_QUEUE_SIZE || len > sizeof(Slot::data))
+	{
+		++m_dropped; // like a full socket buffer would
+		return 0;
+	}
+
+	Slot& slot = m_slots[tail & (SEND_QUEUE_SIZE - 1)];
+	slot.client = client;
+	slot.len = len;
+	std::memcpy(slot.data, ptr, len);
+
+	// seq_cst pairs with the store of m_idle in run(): either the sender sees the new tail or we see it idle
+	m_tail.store(tail + 1);
+
+	if (m_idle.load())
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_cv.notify_one();
+	}
+
+	return len;
+}
+
+void NetworkSender::stop()
+{
+	if (!m_thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_running = false;
+		m_cv.notify_one();
+	}
+
+	m_thread.join();
+}
+
+uint64_t NetworkSender::getDroppedCount() const
+{
+	return m_dropped;
+}
+
+void NetworkSender::run()
+{
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point deadline;
+	bool pacing = false;
+
+	for (;;)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t backlog = m_tail.load(std::memory_order_acquire) - head;
+
+		if (!m_running)
+		{
+			// flush without pacing, the socket is closed right after
+			for (; backlog > 0; --backlog)
+				sendSlot(head++);
+			return;
+		}
+
+		if (backlog == 0)
+		{
+			pacing = false;
+
+			m_idle.store(true);
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this]
+				{
+					return (!m_running || m_tail.load() != m_head.load(std::memory_order_relaxed));
+				});
+			}
+			m_idle.store(false);
+			continue;
+		}
+
+		auto now = Clock::now();
+		if (!pacing)
+		{
+			// a new burst, it has to be out by the end of the window
+			pacing = true;
+			deadline = now + std::chrono::milliseconds(SEND_PACING_WINDOW);
+		}
+
+		// spread what is left evenly over the remaining slices of the window
+		size_t slices_left = (size_t)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() / SEND_PACING_SLICE;
+		size_t batch = (slices_left > 0) ? std::max<size_t>(1, (backlog + slices_left - 1) / slices_left) : backlog;
+
+		for (size_t i = 0; i < batch; ++i)
+			sendSlot(head++);
+
+		if (batch < backlog)
+			std::this_thread::sleep_for(std::chrono::milliseconds(SEND_PACING_SLICE));
+	}
+}
+
+void NetworkSender::sendSlot(size_t index)
+{
+	Slot& slot = m_slots[index & (SEND_QUEUE_SIZE - 1)];
+
+	try
+	{
+		m_backend->write(slot.client, slot.data, slot.len);
+	}
+	catch (raz::NetworkSocketError&)
+	{
+		++m_dropped;
+	}
+
+	m_head.store(index + 1, std::memory_order_release);
+}
@@ -0,0 +1,71 @@
+/*
+Copyright (C) 2017 - Gbor "Razzie" Grzsny
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <raz/network.hpp>
+#include <raz/networkbackend.hpp>
+#include "common/Config.hpp"
+
+/*
+ * Sends the packets of the network thread from a separate thread, so a large sync burst doesn't
+ * delay receiving. Packets are queued in a lock-free single producer, single consumer ring and
+ * a burst is spread over SEND_PACING_WINDOW instead of going out at once.
+ * write() has the same signature as the backend's, so it can be passed to NetworkServer::send.
+ */
+class NetworkSender
+{
+public:
+	typedef raz::NetworkServerBackendUDP<MAX_PACKET_SIZE> Backend;
+	typedef Backend::Client Client;
+
+	NetworkSender(Backend& backend);
+	~NetworkSender();
+	size_t write(const Client& client, const char* ptr, size_t len); // call it from one thread only
+	void stop(); // sends the queued packets and stops the thread
+	uint64_t getDroppedCount() const;
+
+private:
+	struct Slot
+	{
+		Client client;
+		size_t len;
+		char data[sizeof(raz::PacketBuffer<MAX_PACKET_SIZE>::PacketData)];
+	};
+
+	Backend* m_backend;
+	std::vector<Slot> m_slots;
+	alignas(64) std::atomic<size_t> m_head; // next slot to send, written by the sender thread
+	alignas(64) std::atomic<size_t> m_tail; // next free slot, written by the producer
+	std::atomic<uint64_t> m_dropped;
+	std::atomic<bool> m_running;
+	std::atomic<bool> m_idle; // the sender thread is waiting (or about to wait) for packets
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::thread m_thread;
+
+	void run();
+	void sendSlot(size_t index);
+};
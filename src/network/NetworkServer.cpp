@@ -16,18 +16,33 @@ IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
 CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 */
 
+#include <algorithm>
+#include <cstdio>
 #include <ctime>
+#include <random>
 #include "common/PlayerManager.hpp"
+#include "common/Profiler.hpp"
 #include "network/NetworkServer.hpp"
 
 NetworkServer::NetworkServer(IApplication* app, const char* cmdline) :
 	m_app(app),
-	m_sync_id_gen((uint64_t)std::time(NULL))
+	m_sender(m_server.getBackend()),
+	m_sync_id_gen((uint64_t)std::time(NULL)),
+	m_dropped_actions()
 {
+	Profiler::setThreadName("NetworkServer");
+
+	std::random_device rd;
+	m_cookie_key[0] = ((uint64_t)rd() << 32) | rd();
+	m_cookie_key[1] = ((uint64_t)rd() << 32) | rd();
+	m_token_gen.seed(((uint64_t)rd() << 32) | rd());
+
 	uint16_t port = cmdline ? (uint16_t)std::stoul(cmdline) : GAME_PORT;
 
 	if (!m_server.getBackend().open(port))
 		m_app->exit(-1, "Cannot host game");
+
+	m_server.getBackend().getReactor().setTimer(GAME_SYNC_RATE);
 }
 
 NetworkServer::~NetworkServer()
@@ -42,9 +57,10 @@ NetworkServer::~NetworkServer()
 
 	for (auto& client : m_clients)
 	{
-		m_server.send(client, packet);
+		m_server.send(client.first, packet, m_sender);
 	}
 
+	m_sender.stop(); // flushes the queue before the socket goes away
 	m_server.getBackend().close();
 }
 
@@ -62,26 +78,32 @@ void NetworkServer::operator()()
 			break;
 
 		case ClientState::PACKET_RECEIVED:
-			m_data.packet.setMode(raz::SerializationMode::DESERIALIZE);
-			if (const Player* player = getPlayer(m_data.client))
-				handlePacket(m_data.packet, player);
-			else
-				handleHello(m_data.client, m_data.packet);
+			handleReceived(m_data.client, m_data.packet);
 			break;
 		}
 
+		for (auto& client : m_clients)
+		{
+			const Client& addr = client.first;
+			Session& session = client.second;
+			session.channel.update([&](Packet& packet)
+			{
+				packet.getPacketData()->head.session_token = session.token;
+				m_server.send(addr, packet, m_sender);
+			});
+		}
+
 		if (m_timeout.peekElapsed() > CONNECTION_TIMEOUT)
 		{
 			handleClientTimeouts(); // dont really need to run it in every cycle
 			m_timeout.reset();
 		}
 
-		if (m_sync_timer.peekElapsed() > GAME_SYNC_RATE)
+		if (m_server.getBackend().getReactor().consumeTimer())
 		{
 			GameObjectSyncRequest e;
 			e.sync_id = (uint32_t)m_sync_id_gen();
 			m_app->handle(e, EventSource::Network);
-			m_sync_timer.reset();
 		}
 	}
 	catch (raz::NetworkSocketError&)
@@ -99,10 +121,7 @@ void NetworkServer::operator()(Message e)
 	packet.setMode(raz::SerializationMode::SERIALIZE);
 	packet(e);
 
-	for (auto& client : m_clients)
-	{
-		m_server.send(client, packet);
-	}
+	broadcast(packet, true);
 }
 
 void NetworkServer::operator()(GameObjectSync e)
@@ -112,10 +131,7 @@ void NetworkServer::operator()(GameObjectSync e)
 	packet.setMode(raz::SerializationMode::SERIALIZE);
 	packet(e);
 
-	for (auto& client : m_clients)
-	{
-		m_server.send(client, packet);
-	}
+	broadcast(packet, false); // superseded by the next sync anyway, no need to resend
 }
 
 void NetworkServer::operator()(SwitchPlayer e)
@@ -124,12 +140,16 @@ void NetworkServer::operator()(SwitchPlayer e)
 	const Client* client = reinterpret_cast<const Client*>(player->data);
 	if (client)
 	{
+		auto it = m_clients.find(*client);
+		if (it == m_clients.end())
+			return;
+
 		Packet packet;
 		packet.setType((raz::PacketType)EventType::SwitchPlayer);
 		packet.setMode(raz::SerializationMode::SERIALIZE);
 		packet(e);
 
-		m_server.send(*client, packet);
+		send(it->first, it->second, packet, true);
 	}
 }
 
@@ -140,9 +160,31 @@ void NetworkServer::operator()(Highscore e)
 	packet.setMode(raz::SerializationMode::SERIALIZE);
 	packet(e);
 
-	for (auto& client : m_clients)
+	broadcast(packet, false); // lost updates are covered by the periodic full highscore
+}
+
+void NetworkServer::operator()(NetworkStatsRequest e)
+{
+	auto timer_stats = m_server.getBackend().getReactor().getTimerStats();
+	char sync_stats[128];
+	char action_stats[128];
+
+	std::snprintf(sync_stats, sizeof(sync_stats), "sync ticks: %llu, jitter avg: %.2f ms, max: %.2f ms, send drops: %llu",
+		(unsigned long long)timer_stats.ticks, timer_stats.mean_jitter_ms, timer_stats.max_jitter_ms,
+		(unsigned long long)m_sender.getDroppedCount());
+
+	std::snprintf(action_stats, sizeof(action_stats), "dropped actions: %llu add, %llu remove, %llu message, %llu switch",
+		(unsigned long long)m_dropped_actions[AddGameObjectAction],
+		(unsigned long long)m_dropped_actions[RemoveGameObjectAction],
+		(unsigned long long)m_dropped_actions[MessageAction],
+		(unsigned long long)m_dropped_actions[SwitchPlayerAction]);
+
+	for (const char* stats : { sync_stats, action_stats })
 	{
-		m_server.send(client, packet);
+		Message msg;
+		msg.player_id = 0;
+		msg.message.assign(stats, stats + std::strlen(stats));
+		m_app->handle(std::move(msg), EventSource::Network);
 	}
 }
 
@@ -151,7 +193,58 @@ void NetworkServer::operator()(std::exception& e)
 	m_app->exit(-1, e.what());
 }
 
-bool NetworkServer::handlePacket(Packet& packet, const Player* sender)
+void NetworkServer::wakeUp()
+{
+	m_server.getBackend().getReactor().wakeUp();
+}
+
+void NetworkServer::send(const Client& client, Session& session, Packet& packet, bool reliable)
+{
+	session.channel.send(packet, reliable, [&](Packet& packet)
+	{
+		packet.getPacketData()->head.session_token = session.token;
+		m_server.send(client, packet, m_sender);
+	});
+}
+
+void NetworkServer::broadcast(Packet& packet, bool reliable)
+{
+	for (auto& client : m_clients)
+	{
+		send(client.first, client.second, packet, reliable);
+	}
+}
+
+void NetworkServer::handleReceived(Client& client, Packet& packet)
+{
+	PROFILE_ZONE("NetworkServer::handleReceived");
+
+	auto it = m_clients.find(client);
+	if (it == m_clients.end())
+	{
+		handleHello(client, packet);
+		return;
+	}
+
+	// spoofed source address or a leftover from an earlier connection
+	if (packet.getPacketData()->head.session_token != it->second.token)
+		return;
+
+	const Player* player = m_app->getPlayerManager()->findPlayer(&it->first);
+	if (!player)
+		return;
+
+	Channel& channel = it->second.channel;
+
+	if (channel.receive(packet))
+		handlePacket(packet, player, it->second);
+
+	// reliable packets that arrived early and were waiting for this one
+	while (channel.popReady(packet))
+		handlePacket(packet, player, it->second);
+}
+
+bool NetworkServer::handlePacket(Packet& packet, const Player* sender, Session& session)
 {
 	if (packet.getType() == (raz::PacketType)EventType::Ping && sender)
 	{
@@ -159,12 +252,56 @@ bool NetworkServer::handlePacket(Packet& packet, const Player* sender)
 		return true;
 	}
 
+	// every accepted action ends up in the world thread's queue, so a client can't send more than its share
+	if (!checkActionLimit(packet.getType(), session))
+		return false;
+
 	return (tryHandle<SwitchPlayer>(packet, sender)
 		|| tryHandle<Message>(packet, sender)
 		|| tryHandle<AddGameObject>(packet, sender)
 		|| tryHandle<RemoveGameObject>(packet, sender));
 }
 
+bool NetworkServer::checkActionLimit(raz::PacketType type, Session& session)
+{
+	Action action;
+
+	switch ((EventType)type)
+	{
+	case EventType::AddGameObject:
+		action = AddGameObjectAction;
+		break;
+	case EventType::RemoveGameObject:
+		action = RemoveGameObjectAction;
+		break;
+	case EventType::Message:
+		action = MessageAction;
+		break;
+	case EventType::SwitchPlayer:
+		action = SwitchPlayerAction;
+		break;
+	default:
+		return true;
+	}
+
+	if (session.action_limits[action].consume())
+		return true;
+
+	++session.dropped_actions[action];
+	++m_dropped_actions[action];
+	return false;
+}
+
+void NetworkServer::setActionLimits(Session& session)
+{
+	float max_objects = (float)m_app->getPlayerManager()->getMaxGameObjectsPerPlayer();
+
+	session.action_limits[AddGameObjectAction].setLimit(ADD_GAME_OBJECT_RATE_LIMIT, ADD_GAME_OBJECT_BURST_LIMIT);
+	session.action_limits[RemoveGameObjectAction].setLimit(REMOVE_GAME_OBJECT_RATE_LIMIT, std::max((float)REMOVE_GAME_OBJECT_BURST_LIMIT, max_objects));
+	session.action_limits[MessageAction].setLimit(MESSAGE_RATE_LIMIT, MESSAGE_BURST_LIMIT);
+	session.action_limits[SwitchPlayerAction].setLimit(SWITCH_PLAYER_RATE_LIMIT, SWITCH_PLAYER_BURST_LIMIT);
+}
+
 void NetworkServer::handleHello(Client& client, Packet& packet)
 {
 	if (packet.getType() == (raz::PacketType)EventType::Hello)
@@ -175,7 +312,12 @@ void NetworkServer::handleHello(Client& client, Packet& packet)
 
 		if (e.build_hash == Hello::unique_build_hash())
 		{
-			handleConnect(client);
+			// nothing is allocated until the client proves it can receive packets on its address
+			uint32_t age = (uint32_t)m_cookie_clock.peekElapsed() - e.cookie_time;
+			if (e.cookie && age <= CHALLENGE_TIMEOUT && e.cookie == getCookie(client, e.cookie_time))
+				handleConnect(client);
+			else
+				sendChallenge(client);
 		}
 		else
 		{
@@ -187,7 +329,7 @@ void NetworkServer::handleHello(Client& client, Packet& packet)
 			packet.setMode(raz::SerializationMode::SERIALIZE);
 			packet(e);
 
-			m_server.send(client, packet);
+			m_server.send(client, packet, m_sender);
 		}
 	}
 }
@@ -197,33 +339,68 @@ void NetworkServer::handleConnect(Client& client)
 	const Player* player = m_app->getPlayerManager()->addPlayer();
 	if (player)
 	{
-		auto it = m_clients.insert(client).first;
-		player->data = &(*it);
+		auto it = m_clients.emplace(std::piecewise_construct, std::forward_as_tuple(client), std::forward_as_tuple()).first;
+		player->data = &it->first;
+
+		do
+		{
+			it->second.token = m_token_gen();
+		} while (it->second.token == 0);
+
+		setActionLimits(it->second);
 
 		Connected e;
 		e.player_id = player->player_id;
+		e.max_players = m_app->getPlayerManager()->getMaxPlayers();
+		e.max_game_objects_per_player = m_app->getPlayerManager()->getMaxGameObjectsPerPlayer();
 
 		Packet packet;
 		packet.setType((raz::PacketType)EventType::Connected);
 		packet.setMode(raz::SerializationMode::SERIALIZE);
 		packet(e);
 
-		m_server.send(client, packet);
+		send(it->first, it->second, packet, true);
+
+		m_app->handle(std::move(e), EventSource::Network);
 	}
 	else
 	{
 		Disconnected e;
-		e.reason = Disconnected::ServerClosed;
+		e.reason = Disconnected::ServerFull;
 
 		Packet packet;
 		packet.setType((raz::PacketType)EventType::Disconnected);
 		packet.setMode(raz::SerializationMode::SERIALIZE);
 		packet(e);
 
-		m_server.send(client, packet);
+		m_server.send(client, packet, m_sender);
 	}
 }
 
+void NetworkServer::sendChallenge(Client& client)
+{
+	// smaller than Hello, so it can't be used to amplify traffic towards a spoofed address
+	Challenge e;
+	e.cookie_time = (uint32_t)m_cookie_clock.peekElapsed();
+	e.cookie = getCookie(client, e.cookie_time);
+
+	Packet packet;
+	packet.setType((raz::PacketType)EventType::Challenge);
+	packet.setMode(raz::SerializationMode::SERIALIZE);
+	packet(e);
+
+	m_server.send(client, packet, m_sender);
+}
+
+uint64_t NetworkServer::getCookie(const Client& client, uint32_t cookie_time) const
+{
+	char data[sizeof(Client) + sizeof(cookie_time)];
+	std::memcpy(data, &client, sizeof(Client));
+	std::memcpy(&data[sizeof(Client)], &cookie_time, sizeof(cookie_time));
+
+	return raz::siphash(m_cookie_key, data, sizeof(data));
+}
+
 void NetworkServer::handleDisconnect(Client& client)
 {
 	const Player* player = getPlayer(client);
@@ -235,7 +412,7 @@ void NetworkServer::handleDisconnect(Client& client)
 
 		for (auto it = m_clients.begin(), end = m_clients.end(); it != end; ++it)
 		{
-			if (player->data == &(*it))
+			if (player->data == &it->first)
 			{
 				m_clients.erase(it);
 				break;
@@ -249,7 +426,7 @@ void NetworkServer::handleClientTimeouts()
 {
 	for (auto it = m_clients.begin(); it != m_clients.end(); )
 	{
-		const Player* player = m_app->getPlayerManager()->findPlayer(&(*it));
+		const Player* player = m_app->getPlayerManager()->findPlayer(&it->first);
 		if (player)
 		{
 			uint64_t timeout =
@@ -277,5 +454,5 @@ const Player* NetworkServer::getPlayer(Client& client)
 	if (it == m_clients.end())
 		return nullptr;
 
-	return m_app->getPlayerManager()->findPlayer(&(*it));
+	return m_app->getPlayerManager()->findPlayer(&it->first);
 }
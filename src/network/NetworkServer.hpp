@@ -18,12 +18,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #pragma once
 
-#include <set>
+#include <map>
+#include <tuple>
 #include <raz/network.hpp>
 #include <raz/networkbackend.hpp>
 #include <raz/random.hpp>
 #include <raz/timer.hpp>
 #include "common/IApplication.hpp"
+#include "network/NetworkSender.hpp"
 
 class NetworkServer
 {
@@ -35,13 +37,37 @@ public:
 	void operator()(GameObjectSync e);
 	void operator()(SwitchPlayer e);
 	void operator()(Highscore e);
+	void operator()(NetworkStatsRequest e);
 	void operator()(std::exception& e);
+	void wakeUp(); // thread-safe
 
 private:
 	typedef raz::NetworkServerUDP<MAX_PACKET_SIZE>::Client Client;
 	typedef raz::NetworkServerBackendUDP<MAX_PACKET_SIZE>::ClientState ClientState;
 	typedef raz::NetworkServerUDP<MAX_PACKET_SIZE>::ClientData<MAX_PACKET_SIZE> Data;
 	typedef decltype(Data::packet) Packet;
+	typedef raz::ReliableChannel<MAX_PACKET_SIZE> Channel;
+
+	enum Action
+	{
+		AddGameObjectAction,
+		RemoveGameObjectAction,
+		MessageAction,
+		SwitchPlayerAction,
+		ActionCount
+	};
+
+	struct Session
+	{
+		uint64_t token; // expected in the header of every packet from the client
+		Channel channel;
+		raz::TokenBucket action_limits[ActionCount];
+		uint64_t dropped_actions[ActionCount];
+
+		Session() : token(0), dropped_actions()
+		{
+		}
+	};
 
 	struct ClientComparator
 	{
@@ -54,15 +80,26 @@ private:
 	raz::NetworkInitializer m_init;
 	IApplication* m_app;
 	raz::NetworkServerUDP<MAX_PACKET_SIZE> m_server;
+	NetworkSender m_sender; // all packets go through this, receiving is never blocked by sending
 	raz::Timer m_timeout;
-	raz::Timer m_sync_timer;
 	raz::Random m_sync_id_gen;
+	raz::Random m_token_gen;
+	raz::Timer m_cookie_clock;
+	uint64_t m_cookie_key[2];
 	Data m_data;
-	std::set<Client, ClientComparator> m_clients;
+	std::map<Client, Session, ClientComparator> m_clients;
+	uint64_t m_dropped_actions[ActionCount]; // of all clients since the server started
 
-	bool handlePacket(Packet& packet, const Player* sender);
+	void send(const Client& client, Session& session, Packet& packet, bool reliable);
+	void broadcast(Packet& packet, bool reliable);
+	void handleReceived(Client& client, Packet& packet);
+	bool handlePacket(Packet& packet, const Player* sender, Session& session);
+	bool checkActionLimit(raz::PacketType type, Session& session);
+	void setActionLimits(Session& session);
 	void handleHello(Client& client, Packet& packet);
 	void handleConnect(Client& client);
+	void sendChallenge(Client& client);
+	uint64_t getCookie(const Client& client, uint32_t cookie_time) const;
 	void handleDisconnect(Client& client);
 	void handleClientTimeouts();
 	const Player* getPlayer(Client& client);
@@ -91,7 +128,7 @@ private:
 			if (!checkPlayer(e, player))
 				return false;
 
-			m_app->handle(e, EventSource::Network);
+			m_app->handle(std::move(e), EventSource::Network);
 			return true;
 		}
 
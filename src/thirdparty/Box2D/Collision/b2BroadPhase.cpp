@@ -29,10 +29,17 @@ b2BroadPhase::b2BroadPhase()
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_rebuildThreshold = 0.0f;
+
+	m_staleCapacity = 16;
+	m_staleCount = 0;
+	m_staleBuffer = (int32*)b2Alloc(m_staleCapacity * sizeof(int32));
 }
 
 b2BroadPhase::~b2BroadPhase()
 {
+	b2Free(m_staleBuffer);
 	b2Free(m_moveBuffer);
 	b2Free(m_pairBuffer);
 }
@@ -48,12 +55,32 @@ int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
 void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
+
+	for (int32 i = 0; i < m_staleCount; ++i)
+	{
+		if (m_staleBuffer[i] == proxyId)
+		{
+			m_staleBuffer[i] = e_nullProxy;
+		}
+	}
+
 	--m_proxyCount;
 	m_tree.DestroyProxy(proxyId);
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
+	if (m_rebuildThreshold > 0.0f)
+	{
+		// Defer the tree update to UpdatePairs.
+		if (m_tree.UpdateProxyAABB(proxyId, aabb, displacement))
+		{
+			BufferMove(proxyId);
+			BufferStale(proxyId);
+		}
+		return;
+	}
+
 	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
 	if (buffer)
 	{
@@ -61,6 +88,37 @@ void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& di
 	}
 }
 
+void b2BroadPhase::SetRebuildThreshold(float32 fraction)
+{
+	UpdateTree();
+	m_rebuildThreshold = b2Max(fraction, 0.0f);
+}
+
+void b2BroadPhase::UpdateTree()
+{
+	if (m_staleCount == 0)
+	{
+		return;
+	}
+
+	if (m_staleCount >= m_rebuildThreshold * m_proxyCount)
+	{
+		m_tree.RebuildTopDown();
+	}
+	else
+	{
+		for (int32 i = 0; i < m_staleCount; ++i)
+		{
+			if (m_staleBuffer[i] != e_nullProxy)
+			{
+				m_tree.ReinsertProxy(m_staleBuffer[i]);
+			}
+		}
+	}
+
+	m_staleCount = 0;
+}
+
 void b2BroadPhase::TouchProxy(int32 proxyId)
 {
 	BufferMove(proxyId);
@@ -81,6 +139,21 @@ void b2BroadPhase::BufferMove(int32 proxyId)
 	++m_moveCount;
 }
 
+void b2BroadPhase::BufferStale(int32 proxyId)
+{
+	if (m_staleCount == m_staleCapacity)
+	{
+		int32* oldBuffer = m_staleBuffer;
+		m_staleCapacity *= 2;
+		m_staleBuffer = (int32*)b2Alloc(m_staleCapacity * sizeof(int32));
+		memcpy(m_staleBuffer, oldBuffer, m_staleCount * sizeof(int32));
+		b2Free(oldBuffer);
+	}
+
+	m_staleBuffer[m_staleCount] = proxyId;
+	++m_staleCount;
+}
+
 void b2BroadPhase::UnBufferMove(int32 proxyId)
 {
 	for (int32 i = 0; i < m_moveCount; ++i)
@@ -72,9 +72,20 @@ public:
 	int32 GetProxyCount() const;
 
 	/// Update the pairs. This results in pair callbacks. This can only add pairs.
+	/// The tree is up to date with all moved proxies afterwards.
 	template <typename T>
 	void UpdatePairs(T* callback);
 
+	/// Enable deferred tree updates. Moved proxies only get their fat AABB updated in
+	/// MoveProxy, and the tree is fixed up in UpdatePairs: if at least this fraction of
+	/// the proxies moved, the whole tree is rebuilt top-down, otherwise the moved proxies
+	/// are re-inserted one by one. Use 0 to disable (default, incremental updates).
+	void SetRebuildThreshold(float32 fraction);
+
+	/// Bring the tree up to date with proxies moved since the last UpdatePairs.
+	/// Only needed before Query/RayCast if deferred tree updates are enabled.
+	void UpdateTree();
+
 	/// Query an AABB for overlapping proxies. The callback class
 	/// is called for each proxy that overlaps the supplied AABB.
 	template <typename T>
@@ -110,6 +121,7 @@ private:
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
+	void BufferStale(int32 proxyId);
 
 	bool QueryCallback(int32 proxyId);
 
@@ -126,6 +138,12 @@ private:
 	int32 m_pairCount;
 
 	int32 m_queryProxyId;
+
+	float32 m_rebuildThreshold;
+
+	int32* m_staleBuffer;
+	int32 m_staleCapacity;
+	int32 m_staleCount;
 };
 
 /// This is used to sort pairs.
@@ -184,6 +202,8 @@ inline float32 b2BroadPhase::GetTreeQuality() const
 template <typename T>
 void b2BroadPhase::UpdatePairs(T* callback)
 {
+	UpdateTree();
+
 	// Reset pair buffer
 	m_pairCount = 0;
 
@@ -18,6 +18,7 @@
 
 #include "Box2D/Collision/b2DynamicTree.h"
 #include <string.h>
+#include <algorithm>
 
 b2DynamicTree::b2DynamicTree()
 {
@@ -97,6 +98,18 @@ void b2DynamicTree::FreeNode(int32 nodeId)
 	m_nodes[nodeId].height = -1;
 	m_freeList = nodeId;
 	--m_nodeCount;
+
+	// An empty tree starts over with the free list in order, so proxy ids
+	// (and the pair order that depends on them) don't depend on the history.
+	if (m_nodeCount == 0)
+	{
+		for (int32 i = 0; i < m_nodeCapacity - 1; ++i)
+		{
+			m_nodes[i].next = i + 1;
+		}
+		m_nodes[m_nodeCapacity-1].next = b2_nullNode;
+		m_freeList = 0;
+	}
 }
 
 // Create a proxy in the tree as a leaf node. We return the index
@@ -127,7 +140,8 @@ void b2DynamicTree::DestroyProxy(int32 proxyId)
 	FreeNode(proxyId);
 }
 
-bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+// Compute the new fat AABB of a proxy. Returns false if the old one still contains the tight AABB.
+bool b2DynamicTree::FattenAABB(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
 
@@ -138,8 +152,6 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		return false;
 	}
 
-	RemoveLeaf(proxyId);
-
 	// Extend AABB.
 	b2AABB b = aabb;
 	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
@@ -168,11 +180,38 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 	}
 
 	m_nodes[proxyId].aabb = b;
+	return true;
+}
+
+bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
 
+	if (m_nodes[proxyId].aabb.Contains(aabb))
+	{
+		return false;
+	}
+
+	RemoveLeaf(proxyId);
+	FattenAABB(proxyId, aabb, displacement);
 	InsertLeaf(proxyId);
 	return true;
 }
 
+bool b2DynamicTree::UpdateProxyAABB(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	return FattenAABB(proxyId, aabb, displacement);
+}
+
+void b2DynamicTree::ReinsertProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+
+	RemoveLeaf(proxyId);
+	InsertLeaf(proxyId);
+}
+
 void b2DynamicTree::InsertLeaf(int32 leaf)
 {
 	++m_insertionCount;
@@ -769,6 +808,198 @@ void b2DynamicTree::RebuildBottomUp()
 	Validate();
 }
 
+void b2DynamicTree::RebuildTopDown()
+{
+	int32* leaves = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+
+	// Build array of leaves. Free the rest.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			m_nodes[i].parent = b2_nullNode;
+			leaves[count] = i;
+			++count;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	if (count > 0)
+	{
+		m_root = BuildTopDown(leaves, count);
+		m_nodes[m_root].parent = b2_nullNode;
+	}
+	else
+	{
+		m_root = b2_nullNode;
+	}
+
+	b2Free(leaves);
+
+	Validate();
+}
+
+// Recursively build a subtree from the given leaves. Returns the index of the subtree root.
+// Nodes are referenced by index only, AllocateNode may grow the pool.
+int32 b2DynamicTree::BuildTopDown(int32* leaves, int32 count)
+{
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	enum
+	{
+		e_binCount = 16
+	};
+
+	// Bounds of the leaf centers, the split axis is the longest one.
+	b2Vec2 lower = m_nodes[leaves[0]].aabb.GetCenter();
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < count; ++i)
+	{
+		b2Vec2 c = m_nodes[leaves[i]].aabb.GetCenter();
+		lower = b2Min(lower, c);
+		upper = b2Max(upper, c);
+	}
+
+	int32 axis = (upper.x - lower.x >= upper.y - lower.y) ? 0 : 1;
+	float32 minCenter = axis == 0 ? lower.x : lower.y;
+	float32 extent = axis == 0 ? upper.x - lower.x : upper.y - lower.y;
+	int32 split = count / 2;
+
+	if (extent > b2_epsilon && count > 2)
+	{
+		// Binned SAH: sort the leaves into bins by center, then pick the bin boundary with
+		// the lowest perimeter cost.
+		b2AABB binAABB[e_binCount];
+		int32 binCount[e_binCount] = {};
+		float32 scale = e_binCount / extent;
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			const b2AABB& aabb = m_nodes[leaves[i]].aabb;
+			float32 c = axis == 0 ? aabb.GetCenter().x : aabb.GetCenter().y;
+			int32 bin = b2Min(int32((c - minCenter) * scale), int32(e_binCount - 1));
+			if (binCount[bin] == 0)
+			{
+				binAABB[bin] = aabb;
+			}
+			else
+			{
+				binAABB[bin].Combine(aabb);
+			}
+			++binCount[bin];
+		}
+
+		// Right side costs are accumulated from the end.
+		float32 rightCost[e_binCount];
+		b2AABB right;
+		right.lowerBound.SetZero();
+		right.upperBound.SetZero();
+		int32 rightCount = 0;
+		for (int32 i = e_binCount - 1; i > 0; --i)
+		{
+			if (binCount[i] > 0)
+			{
+				if (rightCount == 0)
+				{
+					right = binAABB[i];
+				}
+				else
+				{
+					right.Combine(binAABB[i]);
+				}
+				rightCount += binCount[i];
+			}
+			rightCost[i] = rightCount > 0 ? rightCount * right.GetPerimeter() : 0.0f;
+		}
+
+		float32 minCost = b2_maxFloat;
+		int32 bestBin = -1;
+		b2AABB left;
+		left.lowerBound.SetZero();
+		left.upperBound.SetZero();
+		int32 leftCount = 0;
+		for (int32 i = 0; i < e_binCount - 1; ++i)
+		{
+			if (binCount[i] > 0)
+			{
+				if (leftCount == 0)
+				{
+					left = binAABB[i];
+				}
+				else
+				{
+					left.Combine(binAABB[i]);
+				}
+				leftCount += binCount[i];
+			}
+
+			if (leftCount == 0 || leftCount == count)
+			{
+				continue;
+			}
+
+			float32 cost = leftCount * left.GetPerimeter() + rightCost[i + 1];
+			if (cost < minCost)
+			{
+				minCost = cost;
+				bestBin = i;
+			}
+		}
+
+		if (bestBin >= 0)
+		{
+			int32* mid = std::partition(leaves, leaves + count, [&](int32 leaf)
+			{
+				b2Vec2 c = m_nodes[leaf].aabb.GetCenter();
+				int32 bin = b2Min(int32(((axis == 0 ? c.x : c.y) - minCenter) * scale), int32(e_binCount - 1));
+				return bin <= bestBin;
+			});
+			split = int32(mid - leaves);
+		}
+	}
+
+	if (split <= 0 || split >= count)
+	{
+		// Degenerate distribution, fall back to a median split.
+		split = count / 2;
+		std::nth_element(leaves, leaves + split, leaves + count, [&](int32 a, int32 b)
+		{
+			b2Vec2 ca = m_nodes[a].aabb.GetCenter();
+			b2Vec2 cb = m_nodes[b].aabb.GetCenter();
+			return axis == 0 ? ca.x < cb.x : ca.y < cb.y;
+		});
+	}
+
+	int32 child1 = BuildTopDown(leaves, split);
+	int32 child2 = BuildTopDown(leaves + split, count - split);
+
+	int32 parentIndex = AllocateNode();
+	b2TreeNode* parent = m_nodes + parentIndex;
+	parent->child1 = child1;
+	parent->child2 = child2;
+	parent->height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+	parent->aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	parent->parent = b2_nullNode;
+
+	m_nodes[child1].parent = parentIndex;
+	m_nodes[child2].parent = parentIndex;
+
+	return parentIndex;
+}
+
 void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	// Build array of leaves. Free the rest.
@@ -79,6 +79,14 @@ public:
 	/// @return true if the proxy was re-inserted.
 	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
 
+	/// Same as MoveProxy, but only the fat AABB of the leaf is updated. The tree is left
+	/// stale until the proxy is re-inserted with ReinsertProxy or the tree is rebuilt.
+	/// @return true if the fat AABB was enlarged.
+	bool UpdateProxyAABB(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
+
+	/// Re-insert a proxy whose AABB was changed by UpdateProxyAABB.
+	void ReinsertProxy(int32 proxyId);
+
 	/// Get proxy user data.
 	/// @return the proxy user data or 0 if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
@@ -118,6 +126,10 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Build a new tree top-down from the current leaves, splitting them with binned SAH.
+	/// Much cheaper than RebuildBottomUp and usable every step when most proxies move.
+	void RebuildTopDown();
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -131,6 +143,9 @@ private:
 	void InsertLeaf(int32 node);
 	void RemoveLeaf(int32 node);
 
+	bool FattenAABB(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
+	int32 BuildTopDown(int32* leaves, int32 count);
+
 	int32 Balance(int32 index);
 
 	int32 ComputeHeight() const;
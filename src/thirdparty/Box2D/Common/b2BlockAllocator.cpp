@@ -20,6 +20,7 @@
 #include <limits.h>
 #include <string.h>
 #include <stddef.h>
+#include <atomic>
 
 int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] = 
 {
@@ -52,16 +53,65 @@ struct b2Block
 	b2Block* next;
 };
 
+struct b2BlockCache
+{
+	uint32 owner;
+	b2BlockAllocator* allocator;
+	b2Block* freeLists[b2_blockSizes];
+	int32 counts[b2_blockSizes];
+};
+
+// Caches are direct mapped by allocator id. A cache taken over by another
+// allocator, or left behind by an exiting thread, gives its blocks back to
+// the shared pool of the old owner.
+struct b2ThreadBlockCaches
+{
+	b2BlockCache slots[b2_blockCacheSlots];
+
+	~b2ThreadBlockCaches()
+	{
+		for (int32 i = 0; i < b2_blockCacheSlots; ++i)
+		{
+			b2BlockAllocator::FlushCache(slots + i);
+		}
+	}
+};
+
+static thread_local b2ThreadBlockCaches s_caches;
+static std::atomic<uint32> s_nextAllocatorId(1);
+static b2BlockAllocator* s_allocatorList = nullptr;
+
+// Guards s_allocatorList and the allocator ids. Function local so it exists
+// before any allocator, whatever the static initialization order is.
+static std::mutex& GetAllocatorListMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
 b2BlockAllocator::b2BlockAllocator()
 {
 	b2Assert(b2_blockSizes < UCHAR_MAX);
 
+	{
+		std::lock_guard<std::mutex> lock(GetAllocatorListMutex());
+		m_id = s_nextAllocatorId++;
+		m_prev = nullptr;
+		m_next = s_allocatorList;
+		if (s_allocatorList)
+		{
+			s_allocatorList->m_prev = this;
+		}
+		s_allocatorList = this;
+	}
+
 	m_chunkSpace = b2_chunkArrayIncrement;
 	m_chunkCount = 0;
 	m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
 	
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_freeCounts, 0, sizeof(m_freeCounts));
 
 	if (s_blockSizeLookupInitialized == false)
 	{
@@ -86,6 +136,22 @@ b2BlockAllocator::b2BlockAllocator()
 
 b2BlockAllocator::~b2BlockAllocator()
 {
+	{
+		std::lock_guard<std::mutex> lock(GetAllocatorListMutex());
+		if (m_prev)
+		{
+			m_prev->m_next = m_next;
+		}
+		else
+		{
+			s_allocatorList = m_next;
+		}
+		if (m_next)
+		{
+			m_next->m_prev = m_prev;
+		}
+	}
+
 	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
 		b2Free(m_chunks[i].blocks);
@@ -94,6 +160,98 @@ b2BlockAllocator::~b2BlockAllocator()
 	b2Free(m_chunks);
 }
 
+b2BlockCache* b2BlockAllocator::GetCache()
+{
+	b2BlockCache* cache = s_caches.slots + m_id % b2_blockCacheSlots;
+	if (cache->owner != m_id)
+	{
+		FlushCache(cache);
+		cache->owner = m_id;
+		cache->allocator = this;
+	}
+
+	return cache;
+}
+
+// Splices the cached blocks back into the free lists of their allocator. Blocks
+// of an allocator that has been destroyed or cleared since are simply dropped,
+// their chunks are already freed.
+void b2BlockAllocator::FlushCache(b2BlockCache* cache)
+{
+	if (cache->owner != 0)
+	{
+		std::lock_guard<std::mutex> listLock(GetAllocatorListMutex());
+
+		b2BlockAllocator* owner = s_allocatorList;
+		while (owner && (owner != cache->allocator || owner->m_id != cache->owner))
+		{
+			owner = owner->m_next;
+		}
+
+		if (owner)
+		{
+			std::lock_guard<std::mutex> lock(owner->m_mutex);
+
+			for (int32 index = 0; index < b2_blockSizes; ++index)
+			{
+				b2Block* first = cache->freeLists[index];
+				if (first == nullptr)
+				{
+					continue;
+				}
+
+				b2Block* last = first;
+				while (last->next)
+				{
+					last = last->next;
+				}
+
+				last->next = owner->m_freeLists[index];
+				owner->m_freeLists[index] = first;
+				owner->m_freeCounts[index] += cache->counts[index];
+			}
+		}
+	}
+
+	memset(cache, 0, sizeof(b2BlockCache));
+}
+
+// The caller holds the lock.
+void b2BlockAllocator::AddChunk(int32 index)
+{
+	if (m_chunkCount == m_chunkSpace)
+	{
+		b2Chunk* oldChunks = m_chunks;
+		m_chunkSpace += b2_chunkArrayIncrement;
+		m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
+		memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
+		memset(m_chunks + m_chunkCount, 0, b2_chunkArrayIncrement * sizeof(b2Chunk));
+		b2Free(oldChunks);
+	}
+
+	b2Chunk* chunk = m_chunks + m_chunkCount;
+	chunk->blocks = (b2Block*)b2Alloc(b2_chunkSize);
+#if defined(_DEBUG)
+	memset(chunk->blocks, 0xcd, b2_chunkSize);
+#endif
+	int32 blockSize = s_blockSizes[index];
+	chunk->blockSize = blockSize;
+	int32 blockCount = b2_chunkSize / blockSize;
+	b2Assert(blockCount * blockSize <= b2_chunkSize);
+	for (int32 i = 0; i < blockCount - 1; ++i)
+	{
+		b2Block* block = (b2Block*)((int8*)chunk->blocks + blockSize * i);
+		b2Block* next = (b2Block*)((int8*)chunk->blocks + blockSize * (i + 1));
+		block->next = next;
+	}
+	b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (blockCount - 1));
+	last->next = m_freeLists[index];
+
+	m_freeLists[index] = chunk->blocks;
+	m_freeCounts[index] += blockCount;
+	++m_chunkCount;
+}
+
 void* b2BlockAllocator::Allocate(int32 size)
 {
 	if (size == 0)
@@ -109,47 +267,37 @@ void* b2BlockAllocator::Allocate(int32 size)
 	int32 index = s_blockSizeLookup[size];
 	b2Assert(0 <= index && index < b2_blockSizes);
 
-	if (m_freeLists[index])
-	{
-		b2Block* block = m_freeLists[index];
-		m_freeLists[index] = block->next;
-		return block;
-	}
-	else
+	b2BlockCache* cache = GetCache();
+
+	if (cache->freeLists[index] == nullptr)
 	{
-		if (m_chunkCount == m_chunkSpace)
+		// Refill the cache with a batch from the shared pool.
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		while (m_freeCounts[index] < b2_blockCacheBatch)
 		{
-			b2Chunk* oldChunks = m_chunks;
-			m_chunkSpace += b2_chunkArrayIncrement;
-			m_chunks = (b2Chunk*)b2Alloc(m_chunkSpace * sizeof(b2Chunk));
-			memcpy(m_chunks, oldChunks, m_chunkCount * sizeof(b2Chunk));
-			memset(m_chunks + m_chunkCount, 0, b2_chunkArrayIncrement * sizeof(b2Chunk));
-			b2Free(oldChunks);
+			AddChunk(index);
 		}
 
-		b2Chunk* chunk = m_chunks + m_chunkCount;
-		chunk->blocks = (b2Block*)b2Alloc(b2_chunkSize);
-#if defined(_DEBUG)
-		memset(chunk->blocks, 0xcd, b2_chunkSize);
-#endif
-		int32 blockSize = s_blockSizes[index];
-		chunk->blockSize = blockSize;
-		int32 blockCount = b2_chunkSize / blockSize;
-		b2Assert(blockCount * blockSize <= b2_chunkSize);
-		for (int32 i = 0; i < blockCount - 1; ++i)
+		b2Block* first = m_freeLists[index];
+		b2Block* last = first;
+		for (int32 i = 1; i < b2_blockCacheBatch; ++i)
 		{
-			b2Block* block = (b2Block*)((int8*)chunk->blocks + blockSize * i);
-			b2Block* next = (b2Block*)((int8*)chunk->blocks + blockSize * (i + 1));
-			block->next = next;
+			last = last->next;
 		}
-		b2Block* last = (b2Block*)((int8*)chunk->blocks + blockSize * (blockCount - 1));
-		last->next = nullptr;
 
-		m_freeLists[index] = chunk->blocks->next;
-		++m_chunkCount;
+		m_freeLists[index] = last->next;
+		m_freeCounts[index] -= b2_blockCacheBatch;
+		last->next = nullptr;
 
-		return chunk->blocks;
+		cache->freeLists[index] = first;
+		cache->counts[index] = b2_blockCacheBatch;
 	}
+
+	b2Block* block = cache->freeLists[index];
+	cache->freeLists[index] = block->next;
+	--cache->counts[index];
+	return block;
 }
 
 void b2BlockAllocator::Free(void* p, int32 size)
@@ -171,34 +319,77 @@ void b2BlockAllocator::Free(void* p, int32 size)
 	b2Assert(0 <= index && index < b2_blockSizes);
 
 #ifdef _DEBUG
-	// Verify the memory address and size is valid.
-	int32 blockSize = s_blockSizes[index];
-	bool found = false;
-	for (int32 i = 0; i < m_chunkCount; ++i)
 	{
-		b2Chunk* chunk = m_chunks + i;
-		if (chunk->blockSize != blockSize)
-		{
-			b2Assert(	(int8*)p + blockSize <= (int8*)chunk->blocks ||
-						(int8*)chunk->blocks + b2_chunkSize <= (int8*)p);
-		}
-		else
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Verify the memory address and size is valid.
+		int32 blockSize = s_blockSizes[index];
+		bool found = false;
+		for (int32 i = 0; i < m_chunkCount; ++i)
 		{
-			if ((int8*)chunk->blocks <= (int8*)p && (int8*)p + blockSize <= (int8*)chunk->blocks + b2_chunkSize)
+			b2Chunk* chunk = m_chunks + i;
+			if (chunk->blockSize != blockSize)
 			{
-				found = true;
+				b2Assert(	(int8*)p + blockSize <= (int8*)chunk->blocks ||
+							(int8*)chunk->blocks + b2_chunkSize <= (int8*)p);
+			}
+			else
+			{
+				if ((int8*)chunk->blocks <= (int8*)p && (int8*)p + blockSize <= (int8*)chunk->blocks + b2_chunkSize)
+				{
+					found = true;
+				}
 			}
 		}
-	}
 
-	b2Assert(found);
+		b2Assert(found);
 
-	memset(p, 0xfd, blockSize);
+		memset(p, 0xfd, blockSize);
+	}
 #endif
 
+	b2BlockCache* cache = GetCache();
+
 	b2Block* block = (b2Block*)p;
-	block->next = m_freeLists[index];
-	m_freeLists[index] = block;
+	block->next = cache->freeLists[index];
+	cache->freeLists[index] = block;
+
+	if (++cache->counts[index] == 2 * b2_blockCacheBatch)
+	{
+		// Return the most recently freed batch to the shared pool.
+		b2Block* first = cache->freeLists[index];
+		b2Block* last = first;
+		for (int32 i = 1; i < b2_blockCacheBatch; ++i)
+		{
+			last = last->next;
+		}
+
+		cache->freeLists[index] = last->next;
+		cache->counts[index] -= b2_blockCacheBatch;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		last->next = m_freeLists[index];
+		m_freeLists[index] = first;
+		m_freeCounts[index] += b2_blockCacheBatch;
+	}
+}
+
+void b2BlockAllocator::Reserve(int32 size, int32 count)
+{
+	if (size <= 0 || size > b2_maxBlockSize || count <= 0)
+	{
+		return;
+	}
+
+	int32 index = s_blockSizeLookup[size];
+	int32 blockCount = b2_chunkSize / s_blockSizes[index];
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (int32 i = 0; i < count; i += blockCount)
+	{
+		AddChunk(index);
+	}
 }
 
 void b2BlockAllocator::Clear()
@@ -208,8 +399,14 @@ void b2BlockAllocator::Clear()
 		b2Free(m_chunks[i].blocks);
 	}
 
+	{
+		std::lock_guard<std::mutex> lock(GetAllocatorListMutex());
+		m_id = s_nextAllocatorId++;
+	}
+
 	m_chunkCount = 0;
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+	memset(m_freeCounts, 0, sizeof(m_freeCounts));
 }
@@ -20,18 +20,26 @@
 #define B2_BLOCK_ALLOCATOR_H
 
 #include "Box2D/Common/b2Settings.h"
+#include <mutex>
 
 const int32 b2_chunkSize = 16 * 1024;
 const int32 b2_maxBlockSize = 640;
 const int32 b2_blockSizes = 14;
 const int32 b2_chunkArrayIncrement = 128;
+const int32 b2_blockCacheBatch = 32;
+const int32 b2_blockCacheSlots = 4;
 
 struct b2Block;
 struct b2Chunk;
+struct b2BlockCache;
+struct b2ThreadBlockCaches;
 
 /// This is a small object allocator used for allocating small
 /// objects that persist for more than one time step.
 /// See: http://www.codeproject.com/useritems/Small_Block_Allocator.asp
+/// Each thread keeps a cache of free blocks per size and exchanges them
+/// with the shared pool b2_blockCacheBatch blocks at a time, so the lock
+/// is only taken once per batch.
 class b2BlockAllocator
 {
 public:
@@ -44,15 +52,33 @@ public:
 	/// Free memory. This will use b2Free if the size is larger than b2_maxBlockSize.
 	void Free(void* p, int32 size);
 
+	/// Add room for count more blocks of this size to the shared pool up front.
+	void Reserve(int32 size, int32 count);
+
+	/// Free all chunks. The allocator must not be used by other threads meanwhile.
 	void Clear();
 
 private:
 
+	friend struct b2ThreadBlockCaches;
+
+	b2BlockCache* GetCache();
+	void AddChunk(int32 index);
+	static void FlushCache(b2BlockCache* cache);
+
+	std::mutex m_mutex;
+	uint32 m_id; // owner of the thread caches, changes on Clear
+
+	// Live allocators, so a flushed cache can check its owner still exists.
+	b2BlockAllocator* m_prev;
+	b2BlockAllocator* m_next;
+
 	b2Chunk* m_chunks;
 	int32 m_chunkCount;
 	int32 m_chunkSpace;
 
 	b2Block* m_freeLists[b2_blockSizes];
+	int32 m_freeCounts[b2_blockSizes];
 
 	static int32 s_blockSizes[b2_blockSizes];
 	static uint8 s_blockSizeLookup[b2_maxBlockSize + 1];
@@ -27,7 +27,36 @@
 // Solver debugging is normally disabled because the block solver sometimes has to deal with a poorly conditioned effective mass matrix.
 #define B2_DEBUG_SOLVER 0
 
+// Single point contacts (circles against circles or polygons) can be solved four at a time with SSE2.
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define B2_SIMD_SOLVER 1
+#include <emmintrin.h>
+#else
+#define B2_SIMD_SOLVER 0
+#endif
+
 bool g_blockSolve = true;
+bool g_batchSolve = true;
+
+// Four single point velocity constraints in SoA layout. The constraints of a batch never
+// share a dynamic body, so they can be solved at the same time. Padding lanes have a
+// constraint index of -1 and zero mass, so they never change a velocity.
+struct b2ContactConstraintBatch
+{
+	int32 constraint[4];
+	int32 indexA[4];
+	int32 indexB[4];
+	float32 normalX[4], normalY[4];
+	float32 rAX[4], rAY[4];
+	float32 rBX[4], rBY[4];
+	float32 invMassA[4], invIA[4];
+	float32 invMassB[4], invIB[4];
+	float32 normalMass[4], tangentMass[4];
+	float32 velocityBias[4];
+	float32 friction[4];
+	float32 tangentSpeed[4];
+	float32 normalImpulse[4], tangentImpulse[4];
+};
 
 struct b2ContactPositionConstraint
 {
@@ -54,6 +83,8 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_positions = def->positions;
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
+	m_batches = nullptr;
+	m_batchCount = 0;
 
 	// Initialize position independent portions of the constraints.
 	for (int32 i = 0; i < m_count; ++i)
@@ -133,6 +164,10 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_batches)
+	{
+		m_allocator->Free(m_batches);
+	}
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
@@ -247,6 +282,153 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			}
 		}
 	}
+
+	BuildBatches();
+}
+
+// Group the constraints into batches without a shared dynamic body. Each constraint gets the
+// lowest color not used yet by either of its bodies, then every color is cut into batches of four.
+// Bodies without mass are never written, they can be shared by the lanes of a batch.
+void b2ContactSolver::BuildBatches()
+{
+#if B2_SIMD_SOLVER
+	const int32 k_maxColors = 32;
+	const int32 k_minConstraints = 8;
+
+	if (g_batchSolve == false || m_count < k_minConstraints)
+	{
+		return;
+	}
+
+	int32 bodyCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		if (vc->pointCount != 1)
+		{
+			return;
+		}
+		bodyCount = b2Max(bodyCount, b2Max(vc->indexA, vc->indexB) + 1);
+	}
+
+	// The stack allocator is LIFO, so the batches are reserved for the worst case below the scratch arrays.
+	int32 maxBatchCount = (m_count + 3 * k_maxColors) / 4;
+	m_batches = (b2ContactConstraintBatch*)m_allocator->Allocate(maxBatchCount * sizeof(b2ContactConstraintBatch));
+	uint32* bodyColors = (uint32*)m_allocator->Allocate(bodyCount * sizeof(uint32));
+	int32* colors = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+	int32 colorSizes[k_maxColors] = {};
+	memset(bodyColors, 0, bodyCount * sizeof(uint32));
+
+	bool colored = true;
+	for (int32 i = 0; i < m_count && colored; ++i)
+	{
+		const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		bool staticA = (vc->invMassA == 0.0f && vc->invIA == 0.0f);
+		bool staticB = (vc->invMassB == 0.0f && vc->invIB == 0.0f);
+		uint32 used = (staticA ? 0 : bodyColors[vc->indexA]) | (staticB ? 0 : bodyColors[vc->indexB]);
+
+		if (~used == 0)
+		{
+			// Too many contacts on one body, solve the island one constraint at a time.
+			colored = false;
+			break;
+		}
+
+		int32 color = 0;
+		while (used & (uint32(1) << color))
+		{
+			++color;
+		}
+
+		colors[i] = color;
+		++colorSizes[color];
+		if (staticA == false)
+		{
+			bodyColors[vc->indexA] |= uint32(1) << color;
+		}
+		if (staticB == false)
+		{
+			bodyColors[vc->indexB] |= uint32(1) << color;
+		}
+	}
+
+	if (colored)
+	{
+		int32 firstBatch[k_maxColors];
+		m_batchCount = 0;
+		for (int32 c = 0; c < k_maxColors; ++c)
+		{
+			firstBatch[c] = m_batchCount;
+			m_batchCount += (colorSizes[c] + 3) / 4;
+			colorSizes[c] = 0; // reused as fill count
+		}
+
+		b2Assert(m_batchCount <= maxBatchCount);
+		memset(m_batches, 0, m_batchCount * sizeof(b2ContactConstraintBatch));
+		for (int32 i = 0; i < m_batchCount; ++i)
+		{
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				m_batches[i].constraint[lane] = -1;
+			}
+		}
+
+		for (int32 i = 0; i < m_count; ++i)
+		{
+			const b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+			const b2VelocityConstraintPoint* vcp = vc->points;
+			int32 color = colors[i];
+			b2ContactConstraintBatch* batch = m_batches + firstBatch[color] + colorSizes[color] / 4;
+			int32 lane = colorSizes[color] % 4;
+			++colorSizes[color];
+
+			batch->constraint[lane] = i;
+			batch->indexA[lane] = vc->indexA;
+			batch->indexB[lane] = vc->indexB;
+			batch->normalX[lane] = vc->normal.x;
+			batch->normalY[lane] = vc->normal.y;
+			batch->rAX[lane] = vcp->rA.x;
+			batch->rAY[lane] = vcp->rA.y;
+			batch->rBX[lane] = vcp->rB.x;
+			batch->rBY[lane] = vcp->rB.y;
+			batch->invMassA[lane] = vc->invMassA;
+			batch->invIA[lane] = vc->invIA;
+			batch->invMassB[lane] = vc->invMassB;
+			batch->invIB[lane] = vc->invIB;
+			batch->normalMass[lane] = vcp->normalMass;
+			batch->tangentMass[lane] = vcp->tangentMass;
+			batch->velocityBias[lane] = vcp->velocityBias;
+			batch->friction[lane] = vc->friction;
+			batch->tangentSpeed[lane] = vc->tangentSpeed;
+			batch->normalImpulse[lane] = vcp->normalImpulse;
+			batch->tangentImpulse[lane] = vcp->tangentImpulse;
+		}
+
+		// Padding lanes read the bodies of the first lane, but they are never written back.
+		for (int32 i = 0; i < m_batchCount; ++i)
+		{
+			b2ContactConstraintBatch* batch = m_batches + i;
+			for (int32 lane = 1; lane < 4; ++lane)
+			{
+				if (batch->constraint[lane] < 0)
+				{
+					batch->indexA[lane] = batch->indexA[0];
+					batch->indexB[lane] = batch->indexB[0];
+				}
+			}
+		}
+	}
+
+	m_allocator->Free(colors);
+	m_allocator->Free(bodyColors);
+
+	if (colored == false)
+	{
+		m_allocator->Free(m_batches);
+		m_batches = nullptr;
+		m_batchCount = 0;
+	}
+#endif
 }
 
 void b2ContactSolver::WarmStart()
@@ -291,6 +473,12 @@ void b2ContactSolver::WarmStart()
 
 void b2ContactSolver::SolveVelocityConstraints()
 {
+	if (m_batches)
+	{
+		SolveBatchedVelocityConstraints();
+		return;
+	}
+
 	for (int32 i = 0; i < m_count; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
@@ -601,6 +789,129 @@ void b2ContactSolver::SolveVelocityConstraints()
 	}
 }
 
+void b2ContactSolver::SolveBatchedVelocityConstraints()
+{
+#if B2_SIMD_SOLVER
+	const __m128 zero = _mm_setzero_ps();
+
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		b2ContactConstraintBatch* b = m_batches + i;
+
+		// Gather the body velocities.
+		float32 vAX[4], vAY[4], wA[4], vBX[4], vBY[4], wB[4];
+		for (int32 lane = 0; lane < 4; ++lane)
+		{
+			const b2Velocity& velocityA = m_velocities[b->indexA[lane]];
+			const b2Velocity& velocityB = m_velocities[b->indexB[lane]];
+			vAX[lane] = velocityA.v.x;
+			vAY[lane] = velocityA.v.y;
+			wA[lane] = velocityA.w;
+			vBX[lane] = velocityB.v.x;
+			vBY[lane] = velocityB.v.y;
+			wB[lane] = velocityB.w;
+		}
+
+		__m128 vax = _mm_loadu_ps(vAX);
+		__m128 vay = _mm_loadu_ps(vAY);
+		__m128 wa = _mm_loadu_ps(wA);
+		__m128 vbx = _mm_loadu_ps(vBX);
+		__m128 vby = _mm_loadu_ps(vBY);
+		__m128 wb = _mm_loadu_ps(wB);
+
+		const __m128 nx = _mm_loadu_ps(b->normalX);
+		const __m128 ny = _mm_loadu_ps(b->normalY);
+		const __m128 rax = _mm_loadu_ps(b->rAX);
+		const __m128 ray = _mm_loadu_ps(b->rAY);
+		const __m128 rbx = _mm_loadu_ps(b->rBX);
+		const __m128 rby = _mm_loadu_ps(b->rBY);
+		const __m128 ma = _mm_loadu_ps(b->invMassA);
+		const __m128 ia = _mm_loadu_ps(b->invIA);
+		const __m128 mb = _mm_loadu_ps(b->invMassB);
+		const __m128 ib = _mm_loadu_ps(b->invIB);
+
+		// Tangent constraint first, same as the scalar solver. The tangent is (ny, -nx).
+		{
+			__m128 dvx = _mm_sub_ps(_mm_sub_ps(vbx, _mm_mul_ps(wb, rby)), _mm_sub_ps(vax, _mm_mul_ps(wa, ray)));
+			__m128 dvy = _mm_sub_ps(_mm_add_ps(vby, _mm_mul_ps(wb, rbx)), _mm_add_ps(vay, _mm_mul_ps(wa, rax)));
+			__m128 vt = _mm_sub_ps(_mm_sub_ps(_mm_mul_ps(dvx, ny), _mm_mul_ps(dvy, nx)), _mm_loadu_ps(b->tangentSpeed));
+			__m128 lambda = _mm_mul_ps(_mm_loadu_ps(b->tangentMass), _mm_sub_ps(zero, vt));
+
+			__m128 oldImpulse = _mm_loadu_ps(b->tangentImpulse);
+			__m128 maxFriction = _mm_mul_ps(_mm_loadu_ps(b->friction), _mm_loadu_ps(b->normalImpulse));
+			__m128 newImpulse = _mm_max_ps(_mm_sub_ps(zero, maxFriction), _mm_min_ps(_mm_add_ps(oldImpulse, lambda), maxFriction));
+			lambda = _mm_sub_ps(newImpulse, oldImpulse);
+			_mm_storeu_ps(b->tangentImpulse, newImpulse);
+
+			__m128 px = _mm_mul_ps(lambda, ny);
+			__m128 py = _mm_sub_ps(zero, _mm_mul_ps(lambda, nx));
+
+			vax = _mm_sub_ps(vax, _mm_mul_ps(ma, px));
+			vay = _mm_sub_ps(vay, _mm_mul_ps(ma, py));
+			wa = _mm_sub_ps(wa, _mm_mul_ps(ia, _mm_sub_ps(_mm_mul_ps(rax, py), _mm_mul_ps(ray, px))));
+
+			vbx = _mm_add_ps(vbx, _mm_mul_ps(mb, px));
+			vby = _mm_add_ps(vby, _mm_mul_ps(mb, py));
+			wb = _mm_add_ps(wb, _mm_mul_ps(ib, _mm_sub_ps(_mm_mul_ps(rbx, py), _mm_mul_ps(rby, px))));
+		}
+
+		// Normal constraint
+		{
+			__m128 dvx = _mm_sub_ps(_mm_sub_ps(vbx, _mm_mul_ps(wb, rby)), _mm_sub_ps(vax, _mm_mul_ps(wa, ray)));
+			__m128 dvy = _mm_sub_ps(_mm_add_ps(vby, _mm_mul_ps(wb, rbx)), _mm_add_ps(vay, _mm_mul_ps(wa, rax)));
+			__m128 vn = _mm_add_ps(_mm_mul_ps(dvx, nx), _mm_mul_ps(dvy, ny));
+			__m128 lambda = _mm_mul_ps(_mm_loadu_ps(b->normalMass), _mm_sub_ps(_mm_loadu_ps(b->velocityBias), vn));
+
+			__m128 oldImpulse = _mm_loadu_ps(b->normalImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_add_ps(oldImpulse, lambda), zero);
+			lambda = _mm_sub_ps(newImpulse, oldImpulse);
+			_mm_storeu_ps(b->normalImpulse, newImpulse);
+
+			__m128 px = _mm_mul_ps(lambda, nx);
+			__m128 py = _mm_mul_ps(lambda, ny);
+
+			vax = _mm_sub_ps(vax, _mm_mul_ps(ma, px));
+			vay = _mm_sub_ps(vay, _mm_mul_ps(ma, py));
+			wa = _mm_sub_ps(wa, _mm_mul_ps(ia, _mm_sub_ps(_mm_mul_ps(rax, py), _mm_mul_ps(ray, px))));
+
+			vbx = _mm_add_ps(vbx, _mm_mul_ps(mb, px));
+			vby = _mm_add_ps(vby, _mm_mul_ps(mb, py));
+			wb = _mm_add_ps(wb, _mm_mul_ps(ib, _mm_sub_ps(_mm_mul_ps(rbx, py), _mm_mul_ps(rby, px))));
+		}
+
+		// Scatter the velocities of the real lanes.
+		_mm_storeu_ps(vAX, vax);
+		_mm_storeu_ps(vAY, vay);
+		_mm_storeu_ps(wA, wa);
+		_mm_storeu_ps(vBX, vbx);
+		_mm_storeu_ps(vBY, vby);
+		_mm_storeu_ps(wB, wb);
+
+		for (int32 lane = 0; lane < 4 && b->constraint[lane] >= 0; ++lane)
+		{
+			b2Velocity& velocityA = m_velocities[b->indexA[lane]];
+			b2Velocity& velocityB = m_velocities[b->indexB[lane]];
+			velocityA.v.Set(vAX[lane], vAY[lane]);
+			velocityA.w = wA[lane];
+			velocityB.v.Set(vBX[lane], vBY[lane]);
+			velocityB.w = wB[lane];
+		}
+	}
+
+	// Keep the accumulated impulses of the constraints current for StoreImpulses and the listener.
+	for (int32 i = 0; i < m_batchCount; ++i)
+	{
+		const b2ContactConstraintBatch* b = m_batches + i;
+		for (int32 lane = 0; lane < 4 && b->constraint[lane] >= 0; ++lane)
+		{
+			b2VelocityConstraintPoint* vcp = m_velocityConstraints[b->constraint[lane]].points;
+			vcp->normalImpulse = b->normalImpulse[lane];
+			vcp->tangentImpulse = b->tangentImpulse[lane];
+		}
+	}
+#endif
+}
+
 void b2ContactSolver::StoreImpulses()
 {
 	for (int32 i = 0; i < m_count; ++i)
@@ -27,6 +27,7 @@ class b2Contact;
 class b2Body;
 class b2StackAllocator;
 struct b2ContactPositionConstraint;
+struct b2ContactConstraintBatch;
 
 struct b2VelocityConstraintPoint
 {
@@ -81,6 +82,9 @@ public:
 	bool SolvePositionConstraints();
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
+	void BuildBatches();
+	void SolveBatchedVelocityConstraints();
+
 	b2TimeStep m_step;
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
@@ -89,6 +93,8 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+	b2ContactConstraintBatch* m_batches; // set if every constraint has a single point
+	int32 m_batchCount;
 };
 
 #endif
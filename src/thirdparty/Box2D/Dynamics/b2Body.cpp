@@ -31,7 +31,7 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	b2Assert(b2IsValid(bd->angularDamping) && bd->angularDamping >= 0.0f);
 	b2Assert(b2IsValid(bd->linearDamping) && bd->linearDamping >= 0.0f);
 
-	m_flags = 0;
+	m_flags = e_continuousFlag;
 
 	if (bd->bullet)
 	{
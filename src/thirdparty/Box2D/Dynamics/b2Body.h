@@ -317,6 +317,14 @@ public:
 	/// Is this body treated like a bullet for continuous collision detection?
 	bool IsBullet() const;
 
+	/// Should this body take part in continuous collision detection at all? Bodies that
+	/// move slowly compared to their size cannot tunnel, turning this off saves the
+	/// time of impact computations of their contacts. On by default.
+	void SetContinuous(bool flag);
+
+	/// Does this body take part in continuous collision detection?
+	bool IsContinuous() const;
+
 	/// You can disable sleeping on this body. If you disable sleeping, the
 	/// body will be woken.
 	void SetSleepingAllowed(bool flag);
@@ -418,7 +426,8 @@ private:
 		e_bulletFlag		= 0x0008,
 		e_fixedRotationFlag	= 0x0010,
 		e_activeFlag		= 0x0020,
-		e_toiFlag			= 0x0040
+		e_toiFlag			= 0x0040,
+		e_continuousFlag	= 0x0080
 	};
 
 	b2Body(const b2BodyDef* bd, b2World* world);
@@ -636,6 +645,23 @@ inline bool b2Body::IsBullet() const
 	return (m_flags & e_bulletFlag) == e_bulletFlag;
 }
 
+inline void b2Body::SetContinuous(bool flag)
+{
+	if (flag)
+	{
+		m_flags |= e_continuousFlag;
+	}
+	else
+	{
+		m_flags &= ~e_continuousFlag;
+	}
+}
+
+inline bool b2Body::IsContinuous() const
+{
+	return (m_flags & e_continuousFlag) == e_continuousFlag;
+}
+
 inline void b2Body::SetAwake(bool flag)
 {
 	if (flag)
@@ -537,3 +537,276 @@ void b2Island::Report(const b2ContactVelocityConstraint* constraints)
 		m_listener->PostSolve(c, &impulse);
 	}
 }
+
+namespace
+{
+	// Copies the impulses of an island to their slots instead of calling the user listener.
+	class b2ImpulseRecorder : public b2ContactListener
+	{
+	public:
+		void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse) override
+		{
+			B2_NOT_USED(contact);
+			*m_impulses++ = *impulse;
+		}
+
+		b2ContactImpulse* m_impulses;
+	};
+}
+
+b2IslandSolver::b2IslandSolver(int32 threadCount)
+{
+	b2Assert(threadCount > 0);
+
+	m_threadCount = threadCount;
+	m_solverThreads = (b2SolverThread*)b2Alloc(threadCount * sizeof(b2SolverThread));
+	for (int32 i = 0; i < threadCount; ++i)
+	{
+		void* mem = b2Alloc(sizeof(b2StackAllocator));
+		m_solverThreads[i].allocator = new (mem) b2StackAllocator;
+	}
+
+	m_allowSleep = false;
+	m_record = false;
+	m_generation = 0;
+	m_busyThreads = 0;
+	m_stop = false;
+	m_nextTask = 0;
+	m_taskCount = 0;
+
+	// The calling thread is the first solver thread.
+	for (int32 i = 1; i < threadCount; ++i)
+	{
+		m_threads.emplace_back(&b2IslandSolver::ThreadMain, this, i);
+	}
+}
+
+b2IslandSolver::~b2IslandSolver()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeUp.notify_all();
+
+	for (std::thread& thread : m_threads)
+	{
+		thread.join();
+	}
+
+	for (int32 i = 0; i < m_threadCount; ++i)
+	{
+		m_solverThreads[i].allocator->~b2StackAllocator();
+		b2Free(m_solverThreads[i].allocator);
+	}
+	b2Free(m_solverThreads);
+}
+
+void b2IslandSolver::AddIsland(const b2Island& island)
+{
+	b2IslandRange range;
+	range.bodyStart = (int32)m_bodies.size();
+	range.bodyCount = island.m_bodyCount;
+	range.contactStart = (int32)m_contacts.size();
+	range.contactCount = island.m_contactCount;
+	range.jointStart = (int32)m_joints.size();
+	range.jointCount = island.m_jointCount;
+	range.touchesStatic = false;
+
+	for (int32 i = 0; i < island.m_bodyCount; ++i)
+	{
+		range.touchesStatic |= (island.m_bodies[i]->GetType() == b2_staticBody);
+	}
+
+	m_bodies.insert(m_bodies.end(), island.m_bodies, island.m_bodies + island.m_bodyCount);
+	m_contacts.insert(m_contacts.end(), island.m_contacts, island.m_contacts + island.m_contactCount);
+	m_joints.insert(m_joints.end(), island.m_joints, island.m_joints + island.m_jointCount);
+	m_islands.push_back(range);
+}
+
+void b2IslandSolver::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep,
+						b2ContactListener* listener)
+{
+	int32 islandCount = (int32)m_islands.size();
+	if (islandCount == 0)
+	{
+		return;
+	}
+
+	m_step = step;
+	m_gravity = gravity;
+	m_allowSleep = allowSleep;
+	m_record = (listener != nullptr);
+	m_impulses.resize(m_contacts.size());
+
+	// Islands touching a static body form the first task, the rest is split into
+	// tasks of at least e_minTaskBodies bodies.
+	m_order.clear();
+	m_taskStart.clear();
+	m_taskStart.push_back(0);
+
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		if (m_islands[i].touchesStatic)
+		{
+			m_order.push_back(i);
+		}
+	}
+
+	if (m_order.empty() == false)
+	{
+		m_taskStart.push_back((int32)m_order.size());
+	}
+
+	int32 taskBodies = 0;
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		if (m_islands[i].touchesStatic)
+		{
+			continue;
+		}
+
+		m_order.push_back(i);
+		taskBodies += m_islands[i].bodyCount;
+
+		if (taskBodies >= e_minTaskBodies)
+		{
+			m_taskStart.push_back((int32)m_order.size());
+			taskBodies = 0;
+		}
+	}
+
+	if (taskBodies > 0)
+	{
+		m_taskStart.push_back((int32)m_order.size());
+	}
+
+	for (int32 i = 0; i < m_threadCount; ++i)
+	{
+		m_solverThreads[i].profile.solveInit = 0.0f;
+		m_solverThreads[i].profile.solveVelocity = 0.0f;
+		m_solverThreads[i].profile.solvePosition = 0.0f;
+	}
+
+	m_taskCount = (int32)m_taskStart.size() - 1;
+	m_nextTask = 0;
+
+	if (m_taskCount > 1 && m_threads.empty() == false)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			++m_generation;
+			m_busyThreads = (int32)m_threads.size();
+		}
+		m_wakeUp.notify_all();
+
+		RunTasks(0);
+
+		// Every thread has to leave RunTasks before the task list can be reused.
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_finished.wait(lock, [this] { return m_busyThreads == 0; });
+	}
+	else
+	{
+		RunTasks(0);
+	}
+
+	for (int32 i = 0; i < m_threadCount; ++i)
+	{
+		profile->solveInit += m_solverThreads[i].profile.solveInit;
+		profile->solveVelocity += m_solverThreads[i].profile.solveVelocity;
+		profile->solvePosition += m_solverThreads[i].profile.solvePosition;
+	}
+
+	// Replay the callbacks in the order the islands were built.
+	if (listener)
+	{
+		for (int32 i = 0; i < (int32)m_contacts.size(); ++i)
+		{
+			listener->PostSolve(m_contacts[i], &m_impulses[i]);
+		}
+	}
+
+	m_bodies.clear();
+	m_contacts.clear();
+	m_joints.clear();
+	m_islands.clear();
+}
+
+void b2IslandSolver::ThreadMain(int32 threadIndex)
+{
+	uint32 generation = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeUp.wait(lock, [&] { return m_stop || m_generation != generation; });
+
+			if (m_stop)
+			{
+				return;
+			}
+
+			generation = m_generation;
+		}
+
+		RunTasks(threadIndex);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busyThreads == 0)
+		{
+			m_finished.notify_one();
+		}
+	}
+}
+
+void b2IslandSolver::RunTasks(int32 threadIndex)
+{
+	for (;;)
+	{
+		int32 task = m_nextTask++;
+		if (task >= m_taskCount)
+		{
+			return;
+		}
+
+		SolveTask(threadIndex, task);
+	}
+}
+
+void b2IslandSolver::SolveTask(int32 threadIndex, int32 task)
+{
+	b2SolverThread& thread = m_solverThreads[threadIndex];
+	b2ImpulseRecorder recorder;
+
+	for (int32 i = m_taskStart[task]; i < m_taskStart[task + 1]; ++i)
+	{
+		const b2IslandRange& range = m_islands[m_order[i]];
+
+		b2Island island(range.bodyCount, range.contactCount, range.jointCount,
+						thread.allocator, m_record ? &recorder : nullptr);
+
+		// Adding the bodies again sets their island indices for this island.
+		for (int32 j = 0; j < range.bodyCount; ++j)
+		{
+			island.Add(m_bodies[range.bodyStart + j]);
+		}
+		for (int32 j = 0; j < range.contactCount; ++j)
+		{
+			island.Add(m_contacts[range.contactStart + j]);
+		}
+		for (int32 j = 0; j < range.jointCount; ++j)
+		{
+			island.Add(m_joints[range.jointStart + j]);
+		}
+
+		recorder.m_impulses = m_impulses.data() + range.contactStart;
+
+		b2Profile profile;
+		island.Solve(&profile, m_step, m_gravity, m_allowSleep);
+		thread.profile.solveInit += profile.solveInit;
+		thread.profile.solveVelocity += profile.solveVelocity;
+		thread.profile.solvePosition += profile.solvePosition;
+	}
+}
@@ -22,6 +22,12 @@
 #include "Box2D/Common/b2Math.h"
 #include "Box2D/Dynamics/b2Body.h"
 #include "Box2D/Dynamics/b2TimeStep.h"
+#include "Box2D/Dynamics/b2WorldCallbacks.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 class b2Contact;
 class b2Joint;
@@ -90,4 +96,82 @@ public:
 	int32 m_jointCapacity;
 };
 
+/// This is an internal class. Solves the islands of a time step on a pool of threads.
+/// Islands are collected with AddIsland while the world builds them, then solved together.
+/// Each thread has its own stack allocator. Islands touching a static body are solved by the
+/// same thread one after the other, because static bodies are shared between islands and
+/// b2Island stores its solver index in the bodies. PostSolve callbacks are recorded and replayed
+/// on the calling thread in island order, so the listener sees the same sequence as before.
+class b2IslandSolver
+{
+public:
+	b2IslandSolver(int32 threadCount);
+	~b2IslandSolver();
+
+	int32 GetThreadCount() const
+	{
+		return m_threadCount;
+	}
+
+	/// Copy the bodies, contacts and joints of a built island.
+	void AddIsland(const b2Island& island);
+
+	/// Solve the added islands and forget them. The solver profiles are accumulated.
+	void Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep,
+			b2ContactListener* listener);
+
+private:
+
+	enum
+	{
+		e_minTaskBodies = 64
+	};
+
+	struct b2IslandRange
+	{
+		int32 bodyStart, bodyCount;
+		int32 contactStart, contactCount;
+		int32 jointStart, jointCount;
+		bool touchesStatic;
+	};
+
+	struct b2SolverThread
+	{
+		b2StackAllocator* allocator;
+		b2Profile profile;
+	};
+
+	void ThreadMain(int32 threadIndex);
+	void RunTasks(int32 threadIndex);
+	void SolveTask(int32 threadIndex, int32 task);
+
+	int32 m_threadCount;
+	b2SolverThread* m_solverThreads;
+	std::vector<std::thread> m_threads;
+
+	std::vector<b2Body*> m_bodies;
+	std::vector<b2Contact*> m_contacts;
+	std::vector<b2Joint*> m_joints;
+	std::vector<b2IslandRange> m_islands;
+	std::vector<b2ContactImpulse> m_impulses; // one per contact, filled by PostSolve
+
+	std::vector<int32> m_order; // islands touching a static body first
+	std::vector<int32> m_taskStart; // task i solves m_order[m_taskStart[i]..m_taskStart[i + 1])
+
+	// Parameters of the step being solved.
+	b2TimeStep m_step;
+	b2Vec2 m_gravity;
+	bool m_allowSleep;
+	bool m_record;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeUp;
+	std::condition_variable m_finished;
+	uint32 m_generation;
+	int32 m_busyThreads;
+	bool m_stop;
+	std::atomic<int32> m_nextTask;
+	int32 m_taskCount;
+};
+
 #endif
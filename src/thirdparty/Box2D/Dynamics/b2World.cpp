@@ -23,6 +23,7 @@
 #include "Box2D/Dynamics/Joints/b2PulleyJoint.h"
 #include "Box2D/Dynamics/Contacts/b2Contact.h"
 #include "Box2D/Dynamics/Contacts/b2ContactSolver.h"
+#include "Box2D/Dynamics/Contacts/b2CircleContact.h"
 #include "Box2D/Collision/b2Collision.h"
 #include "Box2D/Collision/b2BroadPhase.h"
 #include "Box2D/Collision/Shapes/b2CircleShape.h"
@@ -60,11 +61,15 @@ b2World::b2World(const b2Vec2& gravity)
 
 	m_contactManager.m_allocator = &m_blockAllocator;
 
+	m_islandSolver = nullptr;
+
 	memset(&m_profile, 0, sizeof(b2Profile));
 }
 
 b2World::~b2World()
 {
+	SetSolverThreadCount(1);
+
 	// Some shapes allocate using b2Alloc.
 	b2Body* b = m_bodyList;
 	while (b)
@@ -382,6 +387,48 @@ void b2World::SetAllowSleeping(bool flag)
 	}
 }
 
+void b2World::SetBroadPhaseRebuildThreshold(float32 fraction)
+{
+	m_contactManager.m_broadPhase.SetRebuildThreshold(fraction);
+}
+
+void b2World::SetSolverThreadCount(int32 count)
+{
+	b2Assert(IsLocked() == false);
+
+	if (count == GetSolverThreadCount())
+	{
+		return;
+	}
+
+	if (m_islandSolver)
+	{
+		m_islandSolver->~b2IslandSolver();
+		b2Free(m_islandSolver);
+		m_islandSolver = nullptr;
+	}
+
+	if (count > 1)
+	{
+		void* mem = b2Alloc(sizeof(b2IslandSolver));
+		m_islandSolver = new (mem) b2IslandSolver(count);
+	}
+}
+
+int32 b2World::GetSolverThreadCount() const
+{
+	return m_islandSolver ? m_islandSolver->GetThreadCount() : 1;
+}
+
+void b2World::ReserveCircleBodies(int32 bodyCount, int32 contactCount)
+{
+	m_blockAllocator.Reserve(sizeof(b2Body), bodyCount);
+	m_blockAllocator.Reserve(sizeof(b2Fixture), bodyCount);
+	m_blockAllocator.Reserve(sizeof(b2FixtureProxy), bodyCount);
+	m_blockAllocator.Reserve(sizeof(b2CircleShape), bodyCount);
+	m_blockAllocator.Reserve(sizeof(b2CircleContact), contactCount);
+}
+
 // Find islands, integrate and solve constraints, solve position constraints
 void b2World::Solve(const b2TimeStep& step)
 {
@@ -527,11 +574,19 @@ void b2World::Solve(const b2TimeStep& step)
 			}
 		}
 
-		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
-		m_profile.solveInit += profile.solveInit;
-		m_profile.solveVelocity += profile.solveVelocity;
-		m_profile.solvePosition += profile.solvePosition;
+		if (m_islandSolver)
+		{
+			// Solved together with the other islands below.
+			m_islandSolver->AddIsland(island);
+		}
+		else
+		{
+			b2Profile profile;
+			island.Solve(&profile, step, m_gravity, m_allowSleep);
+			m_profile.solveInit += profile.solveInit;
+			m_profile.solveVelocity += profile.solveVelocity;
+			m_profile.solvePosition += profile.solvePosition;
+		}
 
 		// Post solve cleanup.
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
@@ -547,6 +602,11 @@ void b2World::Solve(const b2TimeStep& step)
 
 	m_stackAllocator.Free(stack);
 
+	if (m_islandSolver)
+	{
+		m_islandSolver->Solve(&m_profile, step, m_gravity, m_allowSleep, m_contactManager.m_contactListener);
+	}
+
 	{
 		b2Timer timer;
 		// Synchronize fixtures, check for out of range bodies.
@@ -649,6 +709,14 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					continue;
 				}
 
+				// Does a moving body of the pair need continuous collision?
+				bool continuousA = typeA != b2_staticBody && bA->IsContinuous();
+				bool continuousB = typeB != b2_staticBody && bB->IsContinuous();
+				if (continuousA == false && continuousB == false)
+				{
+					continue;
+				}
+
 				bool collideA = bA->IsBullet() || typeA != b2_dynamicBody;
 				bool collideB = bB->IsBullet() || typeB != b2_dynamicBody;
 
@@ -988,6 +1056,7 @@ void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
 	b2WorldQueryWrapper wrapper;
 	wrapper.broadPhase = &m_contactManager.m_broadPhase;
 	wrapper.callback = callback;
+	const_cast<b2BroadPhase&>(m_contactManager.m_broadPhase).UpdateTree();
 	m_contactManager.m_broadPhase.Query(&wrapper, aabb);
 }
 
@@ -1025,6 +1094,7 @@ void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b
 	input.maxFraction = 1.0f;
 	input.p1 = point1;
 	input.p2 = point2;
+	const_cast<b2BroadPhase&>(m_contactManager.m_broadPhase).UpdateTree();
 	m_contactManager.m_broadPhase.RayCast(&wrapper, input);
 }
 
@@ -33,6 +33,7 @@ struct b2JointDef;
 class b2Body;
 class b2Draw;
 class b2Fixture;
+class b2IslandSolver;
 class b2Joint;
 
 /// The world class manages all physics entities, dynamic simulation,
@@ -157,6 +158,19 @@ public:
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Defer broad-phase tree updates to the end of the step and rebuild the tree top-down
+	/// when at least this fraction of the proxies moved. Use 0 for incremental updates.
+	void SetBroadPhaseRebuildThreshold(float32 fraction);
+
+	/// Solve independent islands on this many threads, including the calling one.
+	/// PostSolve callbacks are delayed until all islands are solved. Use 1 for serial solving.
+	void SetSolverThreadCount(int32 count);
+	int32 GetSolverThreadCount() const;
+
+	/// Pre-allocate memory for this many bodies with a single circle fixture each
+	/// and this many circle contacts, so creating them does not grow the allocator.
+	void ReserveCircleBodies(int32 bodyCount, int32 contactCount);
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
@@ -232,6 +246,7 @@ private:
 
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
+	b2IslandSolver* m_islandSolver;
 
 	int32 m_flags;
 
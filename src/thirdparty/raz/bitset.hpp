@@ -26,6 +26,10 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #include <iterator>
 #include <stdexcept>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace raz
 {
 	template<size_t N>
@@ -36,7 +40,7 @@ namespace raz
 		{
 		public:
 			TrueBitIterator(const TrueBitIterator& other) :
-				m_data(other.m_data), m_bit(other.m_bit), m_last_bit(other.m_last_bit)
+				m_data(other.m_data), m_bit(other.m_bit), m_last_bit(other.m_last_bit), m_value(other.m_value)
 			{
 			}
 
@@ -45,6 +49,7 @@ namespace raz
 				m_data = other.m_data;
 				m_bit = other.m_bit;
 				m_last_bit = other.m_last_bit;
+				m_value = other.m_value;
 				return *this;
 			}
 
@@ -52,8 +57,8 @@ namespace raz
 			{
 				if (m_bit < m_last_bit)
 				{
-					++m_bit;
-					findNext();
+					m_value &= m_value - 1; // clear the current bit
+					m_bit = findBit(m_data, m_bit, m_last_bit, 0, m_value);
 				}
 				return *this;
 			}
@@ -81,46 +86,21 @@ namespace raz
 			}
 
 		private:
-			const uint32_t* m_data;
+			const uint64_t* m_data;
 			size_t m_bit;
 			size_t m_last_bit;
+			uint64_t m_value; // bits of the current word not visited yet
 
 			friend class Bitset;
 
-			TrueBitIterator(const uint32_t* data, size_t bit, size_t last_bit) :
-				m_data(data), m_bit(bit), m_last_bit(last_bit)
-			{
-				findNext();
-			}
-
-			void findNext()
+			TrueBitIterator(const uint64_t* data, size_t bit, size_t last_bit) :
+				m_data(data), m_bit(bit), m_last_bit(last_bit), m_value(0)
 			{
-				if (m_bit == m_last_bit)
-					return;
-
-				uint32_t value;
-
-				if (m_bit % 32)
-					value = m_data[m_bit / 32] >> ((m_bit % 32) - 1);
-				
-				do
+				if (m_bit < m_last_bit)
 				{
-					if (m_bit % 32)
-						value >>= 1;
-					else
-						value = m_data[m_bit / 32] >> (m_bit % 32);
-
-					if (value == 0)
-						m_bit += (32 - (m_bit % 32)); // skip the remaining of this 32bit block
-					else if ((value & 1) != 0)
-						return;
-					else
-						++m_bit;
-
-				} while (m_bit < m_last_bit);
-
-				if (m_bit >= m_last_bit)
-					m_bit = m_last_bit;
+					m_value = (m_data[m_bit / 64] ^ 0) & (~0ull << (m_bit % 64));
+					m_bit = findBit(m_data, m_bit, m_last_bit, 0, m_value);
+				}
 			}
 		};
 
@@ -128,7 +108,7 @@ namespace raz
 		{
 		public:
 			FalseBitIterator(const FalseBitIterator& other) :
-				m_data(other.m_data), m_bit(other.m_bit), m_last_bit(other.m_last_bit)
+				m_data(other.m_data), m_bit(other.m_bit), m_last_bit(other.m_last_bit), m_value(other.m_value)
 			{
 			}
 
@@ -137,6 +117,7 @@ namespace raz
 				m_data = other.m_data;
 				m_bit = other.m_bit;
 				m_last_bit = other.m_last_bit;
+				m_value = other.m_value;
 				return *this;
 			}
 
@@ -144,8 +125,8 @@ namespace raz
 			{
 				if (m_bit < m_last_bit)
 				{
-					++m_bit;
-					findNext();
+					m_value &= m_value - 1; // clear the current bit
+					m_bit = findBit(m_data, m_bit, m_last_bit, ~0ull, m_value);
 				}
 				return *this;
 			}
@@ -173,46 +154,21 @@ namespace raz
 			}
 
 		private:
-			const uint32_t* m_data;
+			const uint64_t* m_data;
 			size_t m_bit;
 			size_t m_last_bit;
+			uint64_t m_value; // bits of the current word not visited yet
 
 			friend class Bitset;
 
-			FalseBitIterator(const uint32_t* data, size_t bit, size_t last_bit) :
-				m_data(data), m_bit(bit), m_last_bit(last_bit)
-			{
-				findNext();
-			}
-
-			void findNext()
+			FalseBitIterator(const uint64_t* data, size_t bit, size_t last_bit) :
+				m_data(data), m_bit(bit), m_last_bit(last_bit), m_value(0)
 			{
-				if (m_bit == m_last_bit)
-					return;
-
-				uint32_t value;
-
-				if (m_bit % 32)
-					value = ~m_data[m_bit / 32] >> ((m_bit % 32) - 1);
-
-				do
+				if (m_bit < m_last_bit)
 				{
-					if (m_bit % 32)
-						value >>= 1;
-					else
-						value = ~m_data[m_bit / 32] >> (m_bit % 32);
-
-					if (value == 0)
-						m_bit += (32 - (m_bit % 32)); // skip the remaining of this 32bit block
-					else if ((value & 1) != 0)
-						return;
-					else
-						++m_bit;
-
-				} while (m_bit < m_last_bit);
-
-				if (m_bit >= m_last_bit)
-					m_bit = m_last_bit;
+					m_value = (m_data[m_bit / 64] ^ ~0ull) & (~0ull << (m_bit % 64));
+					m_bit = findBit(m_data, m_bit, m_last_bit, ~0ull, m_value);
+				}
 			}
 		};
 
@@ -305,7 +261,7 @@ namespace raz
 			if (pos >= N)
 				throw std::out_of_range({});
 
-			return (m_data[pos / 32] & (1u << (pos % 32))) != 0;
+			return (m_data[pos / 64] & (1ull << (pos % 64))) != 0;
 		}
 
 		void set(size_t pos)
@@ -313,7 +269,7 @@ namespace raz
 			if (pos >= N)
 				throw std::out_of_range({});
 
-			m_data[pos / 32] |= (1u << (pos % 32));
+			m_data[pos / 64] |= (1ull << (pos % 64));
 		}
 
 		void unset(size_t pos)
@@ -321,7 +277,7 @@ namespace raz
 			if (pos >= N)
 				throw std::out_of_range({});
 
-			m_data[pos / 32] &= ~(1u << (pos % 32));
+			m_data[pos / 64] &= ~(1ull << (pos % 64));
 		}
 
 		void reset()
@@ -329,6 +285,47 @@ namespace raz
 			std::memset(m_data, 0, sizeof(m_data));
 		}
 
+		// returns the first position of count consecutive unset bits, or N if there is none
+		size_t findFalseBits(size_t count) const
+		{
+			if (count == 0)
+				return 0;
+
+			size_t run_pos = 0;
+			size_t run_size = 0;
+
+			for (size_t i = 0; i < DATA_SIZE; ++i)
+			{
+				uint64_t value = m_data[i];
+				size_t bit = 0;
+
+				while (bit < 64)
+				{
+					uint64_t rest = value >> bit;
+					if (rest == 0)
+					{
+						run_size += 64 - bit;
+						break;
+					}
+
+					size_t zeros = findFirstTrueBit(rest);
+					run_size += zeros;
+					if (run_size >= count)
+						break;
+
+					uint64_t ones = ~(rest >> zeros); // skip the set bits
+					bit += zeros + (ones ? findFirstTrueBit(ones) : 64);
+					run_pos = i * 64 + bit;
+					run_size = 0;
+				}
+
+				if (run_size >= count)
+					return (run_pos + count <= N) ? run_pos : N; // bits past N are never set
+			}
+
+			return N;
+		}
+
 		const void* data() const
 		{
 			return m_data;
@@ -357,17 +354,65 @@ namespace raz
 		}
 
 	private:
-		static constexpr size_t DATA_SIZE = ((N - 1) / 32) + 1;
-		uint32_t m_data[DATA_SIZE];
+		static constexpr size_t DATA_SIZE = ((N - 1) / 64) + 1;
+		uint64_t m_data[DATA_SIZE];
+
+		// value holds the remaining bits (xor flip) of the word containing 'bit', returns
+		// the first of them or of the following words, or last_bit if there is none
+		static size_t findBit(const uint64_t* data, size_t bit, size_t last_bit, uint64_t flip, uint64_t& value)
+		{
+			size_t i = bit / 64;
+
+			while (value == 0)
+			{
+				if (++i == DATA_SIZE)
+					return last_bit;
+
+				value = data[i] ^ flip;
+			}
+
+			bit = i * 64 + findFirstTrueBit(value);
+			return (bit < last_bit) ? bit : last_bit;
+		}
+
+		// x must not be 0
+		static size_t findFirstTrueBit(uint64_t x)
+		{
+#if defined(_MSC_VER) && defined(_M_X64)
+			unsigned long index;
+			_BitScanForward64(&index, x);
+			return index;
+#elif defined(_MSC_VER)
+			unsigned long index;
+			if (_BitScanForward(&index, static_cast<uint32_t>(x)))
+				return index;
+			_BitScanForward(&index, static_cast<uint32_t>(x >> 32));
+			return 32 + index;
+#elif defined(__GNUC__)
+			return __builtin_ctzll(x);
+#else
+			size_t index = 0;
+			while ((x & 1) == 0)
+			{
+				x >>= 1;
+				++index;
+			}
+			return index;
+#endif
+		}
 
-		static size_t countTrueBits(uint32_t x)
+		static size_t countTrueBits(uint64_t x)
 		{
-			x = x - ((x >> 1) & 0x55555555);
-			x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
-			x = (x + (x >> 4)) & 0x0F0F0F0F;
-			x = x + (x >> 8);
-			x = x + (x >> 16);
-			return x & 0x0000003F;
+#if defined(__GNUC__) && defined(__POPCNT__)
+			return __builtin_popcountll(x);
+#elif defined(_MSC_VER) && defined(_M_X64) && defined(__AVX__) // popcnt is not guaranteed below AVX
+			return __popcnt64(x);
+#else
+			x = x - ((x >> 1) & 0x5555555555555555ull);
+			x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+			x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+			return (x * 0x0101010101010101ull) >> 56;
+#endif
 		}
 	};
 }
@@ -22,7 +22,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #pragma once
 #pragma warning(disable: 4307)
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 namespace raz
 {
@@ -35,4 +37,57 @@ namespace raz
 	{
 		return (str[0] == 0) ? h : hash(&str[1], h * 33 + str[0]);
 	}
+
+	/*
+	SipHash-2-4 keyed hash, usable as a MAC for short messages
+	https://131002.net/siphash/
+	*/
+
+	inline uint64_t siphash(const uint64_t key[2], const void* data, size_t len)
+	{
+		auto rotl = [](uint64_t x, int b) { return (x << b) | (x >> (64 - b)); };
+
+		uint64_t v0 = key[0] ^ 0x736f6d6570736575ull;
+		uint64_t v1 = key[1] ^ 0x646f72616e646f6dull;
+		uint64_t v2 = key[0] ^ 0x6c7967656e657261ull;
+		uint64_t v3 = key[1] ^ 0x7465646279746573ull;
+
+		auto round = [&]()
+		{
+			v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+			v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+			v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+			v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+		};
+
+		const unsigned char* ptr = static_cast<const unsigned char*>(data);
+		const unsigned char* end = ptr + (len & ~(size_t)7);
+
+		for (; ptr != end; ptr += 8)
+		{
+			uint64_t m;
+			std::memcpy(&m, ptr, 8); // assumes little endian
+			v3 ^= m;
+			round();
+			round();
+			v0 ^= m;
+		}
+
+		uint64_t b = (uint64_t)len << 56;
+		for (size_t i = 0; i < (len & 7); ++i)
+			b |= (uint64_t)ptr[i] << (8 * i);
+
+		v3 ^= b;
+		round();
+		round();
+		v0 ^= b;
+
+		v2 ^= 0xff;
+		round();
+		round();
+		round();
+		round();
+
+		return v0 ^ v1 ^ v2 ^ v3;
+	}
 }
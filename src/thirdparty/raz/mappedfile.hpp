@@ -0,0 +1,311 @@
+/*
+Copyright (C) 2016 - Gbor "Razzie" Grzsny
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+the Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
+*/
+
+#pragma once
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include "raz/serialization.hpp"
+
+namespace raz
+{
+	class MappedFileError : public std::exception
+	{
+	public:
+		virtual const char* what() const noexcept
+		{
+			return "Mapped file error";
+		}
+	};
+
+	/*
+	Serializer buffer on top of a memory-mapped file. SERIALIZE creates or truncates the
+	file and grows the mapping as data gets written, then cuts the file to the written
+	size when closed. DESERIALIZE maps an existing file read-only. Writing costs about as
+	much as copying to memory, the data only goes to disk in close(), so a closed file can
+	safely be swapped in with replaceFile.
+	*/
+	class MappedFileBuffer
+	{
+	public:
+		MappedFileBuffer(const char* filename, SerializationMode mode, size_t capacity = 64 * 1024) :
+			m_mode(mode),
+			m_data(nullptr),
+			m_size(0),
+			m_capacity(0),
+			m_pos(0)
+		{
+#ifdef _WIN32
+			m_mapping = NULL;
+			m_file = CreateFileA(filename,
+				(mode == SerializationMode::SERIALIZE) ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+				FILE_SHARE_READ, NULL,
+				(mode == SerializationMode::SERIALIZE) ? CREATE_ALWAYS : OPEN_EXISTING,
+				FILE_ATTRIBUTE_NORMAL, NULL);
+
+			if (m_file == INVALID_HANDLE_VALUE)
+				throw MappedFileError();
+
+			if (mode == SerializationMode::DESERIALIZE)
+			{
+				LARGE_INTEGER file_size;
+				if (!GetFileSizeEx(m_file, &file_size))
+				{
+					close();
+					throw MappedFileError();
+				}
+				m_size = (size_t)file_size.QuadPart;
+			}
+#else
+			m_file = (mode == SerializationMode::SERIALIZE)
+				? ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644)
+				: ::open(filename, O_RDONLY);
+
+			if (m_file < 0)
+				throw MappedFileError();
+
+			if (mode == SerializationMode::DESERIALIZE)
+			{
+				struct stat file_stat;
+				if (fstat(m_file, &file_stat) != 0)
+				{
+					close();
+					throw MappedFileError();
+				}
+				m_size = (size_t)file_stat.st_size;
+			}
+#endif
+
+			if (mode == SerializationMode::DESERIALIZE)
+				capacity = m_size;
+
+			if (capacity > 0 && !map(capacity))
+			{
+				close();
+				throw MappedFileError();
+			}
+		}
+
+		MappedFileBuffer(const MappedFileBuffer&) = delete;
+
+		MappedFileBuffer& operator=(const MappedFileBuffer&) = delete;
+
+		~MappedFileBuffer()
+		{
+			close();
+		}
+
+		SerializationMode getMode() const
+		{
+			return m_mode;
+		}
+
+		// bytes written so far, or the size of the file being read
+		size_t getSize() const
+		{
+			return m_size;
+		}
+
+		size_t write(const char* ptr, size_t len)
+		{
+			if (len == 0)
+				return 0; // an empty array, ptr may be null
+
+			if (m_capacity - m_size < len)
+			{
+				size_t capacity = (m_capacity > 0) ? m_capacity * 2 : len;
+				if (capacity < m_size + len)
+					capacity = m_size + len;
+
+				unmap();
+				if (!map(capacity))
+					return 0;
+			}
+
+			std::memcpy(m_data + m_size, ptr, len);
+			m_size += len;
+			return len;
+		}
+
+		size_t read(char* ptr, size_t len)
+		{
+			if (len == 0)
+				return 0; // an empty array, ptr may be null
+
+			if (m_size - m_pos < len)
+				len = m_size - m_pos;
+
+			std::memcpy(ptr, m_data + m_pos, len);
+			m_pos += len;
+			return len;
+		}
+
+		// returns len bytes in place and skips them, or nullptr if there are not enough
+		const char* view(size_t len)
+		{
+			if (m_size - m_pos < len)
+				return nullptr;
+
+			const char* ptr = m_data + m_pos;
+			m_pos += len;
+			return ptr;
+		}
+
+		// returns false if the written data could not be flushed to disk
+		bool close()
+		{
+			bool flushed = true;
+
+#ifdef _WIN32
+			if (m_data != nullptr && m_mode == SerializationMode::SERIALIZE)
+				flushed = (FlushViewOfFile(m_data, m_size) != 0);
+
+			unmap();
+
+			if (m_file != INVALID_HANDLE_VALUE)
+			{
+				if (m_mode == SerializationMode::SERIALIZE)
+				{
+					LARGE_INTEGER file_size;
+					file_size.QuadPart = (LONGLONG)m_size;
+					flushed = SetFilePointerEx(m_file, file_size, NULL, FILE_BEGIN)
+						&& SetEndOfFile(m_file)
+						&& FlushFileBuffers(m_file)
+						&& flushed;
+				}
+
+				CloseHandle(m_file);
+				m_file = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (m_data != nullptr && m_mode == SerializationMode::SERIALIZE)
+				flushed = (msync(m_data, m_capacity, MS_SYNC) == 0);
+
+			unmap();
+
+			if (m_file >= 0)
+			{
+				if (m_mode == SerializationMode::SERIALIZE)
+				{
+					flushed = (ftruncate(m_file, (off_t)m_size) == 0)
+						&& (fsync(m_file) == 0)
+						&& flushed;
+				}
+
+				::close(m_file);
+				m_file = -1;
+			}
+#endif
+
+			return flushed;
+		}
+
+	private:
+		SerializationMode m_mode;
+		char* m_data;
+		size_t m_size;
+		size_t m_capacity;
+		size_t m_pos;
+#ifdef _WIN32
+		HANDLE m_file;
+		HANDLE m_mapping;
+#else
+		int m_file;
+#endif
+
+		// a writable mapping extends the file to the capacity
+		bool map(size_t capacity)
+		{
+#ifdef _WIN32
+			bool writable = (m_mode == SerializationMode::SERIALIZE);
+
+			m_mapping = CreateFileMappingA(m_file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+				(DWORD)((uint64_t)capacity >> 32), (DWORD)capacity, NULL);
+			if (m_mapping == NULL)
+				return false;
+
+			m_data = static_cast<char*>(MapViewOfFile(m_mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, capacity));
+			if (m_data == nullptr)
+			{
+				CloseHandle(m_mapping);
+				m_mapping = NULL;
+				return false;
+			}
+#else
+			bool writable = (m_mode == SerializationMode::SERIALIZE);
+
+			if (writable && ftruncate(m_file, (off_t)capacity) != 0)
+				return false;
+
+			void* data = mmap(nullptr, capacity, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, m_file, 0);
+			if (data == MAP_FAILED)
+				return false;
+
+			m_data = static_cast<char*>(data);
+#endif
+			m_capacity = capacity;
+			return true;
+		}
+
+		void unmap()
+		{
+			if (m_data == nullptr)
+				return;
+
+#ifdef _WIN32
+			UnmapViewOfFile(m_data);
+			CloseHandle(m_mapping);
+			m_mapping = NULL;
+#else
+			munmap(m_data, m_capacity);
+#endif
+			m_data = nullptr;
+			m_capacity = 0;
+		}
+	};
+
+	template<bool EndiannessConversion = false>
+	using MappedFile = Serializer<MappedFileBuffer, EndiannessConversion>;
+
+	// replaces the destination even if it exists, so a file can be written aside and swapped in
+	inline bool replaceFile(const char* from, const char* to)
+	{
+#ifdef _WIN32
+		return (MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0);
+#else
+		return (std::rename(from, to) == 0);
+#endif
+	}
+}
@@ -21,7 +21,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
+#include <new>
 #include <type_traits>
 #include "raz/bitset.hpp"
 
@@ -70,65 +72,283 @@ namespace raz
 		{
 			std::lock_guard<Lock> guard(m_lock);
 
-			auto available = m_chunks.falsebits();
-			auto begin_iter = available.begin();
-			auto end_iter = available.end();
+			const size_t chunks = ((bytes - 1) / ALIGNMENT) + 1;
+			const size_t chunk_pos = m_chunks.findFalseBits(chunks);
 
-			if (begin_iter == end_iter)
+			if (chunk_pos == SIZE / ALIGNMENT)
 				throw std::bad_alloc();
 
+			for (size_t i = chunk_pos; i < chunk_pos + chunks; ++i)
+			{
+				m_chunks.set(i);
+			}
+
+			return m_memory + (chunk_pos * ALIGNMENT);
+		}
+
+		virtual void deallocate(void* ptr, size_t bytes)
+		{
+			std::lock_guard<Lock> guard(m_lock);
+
 			const size_t chunks = ((bytes - 1) / ALIGNMENT) + 1;
-			size_t current_chunk_pos = *begin_iter;
-			size_t current_chunk_size = 0;
+			const size_t starting_chunk = (static_cast<char*>(ptr) - m_memory) / ALIGNMENT;
+
+			for (size_t i = starting_chunk; i < starting_chunk + chunks; ++i)
+			{
+				m_chunks.unset(i);
+			}
+		}
+
+		virtual size_t getFreeMemory() const
+		{
+			return (m_chunks.falsebits().count() * ALIGNMENT);
+		}
+
+		virtual size_t getUsedMemory() const
+		{
+			return (m_chunks.truebits().count() * ALIGNMENT);
+		}
+
+	private:
+		struct DummyMutex
+		{
+			void lock() {};
+			void unlock() {};
+		};
+
+		typedef std::conditional_t<std::is_same<Mutex, void>::value, DummyMutex, Mutex> Lock;
+
+		Bitset<SIZE / ALIGNMENT> m_chunks;
+		Lock m_lock;
+		char m_memory[SIZE];
+	};
+
+	struct MemoryPoolStats
+	{
+		size_t used;       // bytes in blocks handed out
+		size_t requested;  // bytes asked for, the rest of 'used' is lost to rounding
+		size_t high_water; // highest 'used' so far
+		size_t class_free; // free bytes already bound to a size class, blocks cached by threads included
+		size_t page_free;  // free bytes in unassigned pages
+
+		// share of the free memory that is bound to a size class and cannot serve other sizes
+		double fragmentation() const
+		{
+			size_t free = class_free + page_free;
+			return (free > 0) ? static_cast<double>(class_free) / free : 0.0;
+		}
+	};
+
+	/*
+	Segregated fit pool: blocks up to MAX_CLASS_SIZE come from per size class free
+	lists in O(1), pages are assigned to size classes on demand and never given back.
+	Bigger blocks take a run of whole pages. With THREAD_CACHE each thread keeps a
+	magazine of blocks per size class and only locks to exchange half of it. A magazine
+	goes back to its pool when the thread switches to another pool of the same type or exits.
+	*/
+	template<size_t SIZE, bool THREAD_CACHE = false, class Mutex = std::mutex>
+	class SizeClassMemoryPool : public IMemoryPool
+	{
+	public:
+		static constexpr size_t PAGE_SIZE = 16 * 1024;
+		static constexpr size_t MAX_CLASS_SIZE = 4096;
+		static constexpr size_t MAGAZINE_SIZE = 32;
+
+		static_assert(SIZE % PAGE_SIZE == 0, "SIZE must be a multiple of PAGE_SIZE");
+
+		SizeClassMemoryPool() :
+			m_id(nextPoolId()),
+			m_used(0),
+			m_requested(0),
+			m_high_water(0),
+			m_cached(0),
+			m_prev(nullptr),
+			m_next(nullptr)
+		{
+			static const size_t class_sizes[CLASS_COUNT] = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096 };
+
+			for (size_t i = 0, size = 0; size <= MAX_CLASS_SIZE / ALIGNMENT; ++size)
+			{
+				if (size * ALIGNMENT > class_sizes[i])
+					++i;
+				m_class_lookup[size] = static_cast<uint8_t>(i);
+			}
+
+			for (size_t i = 0; i < CLASS_COUNT; ++i)
+				m_classes[i] = { class_sizes[i], nullptr, nullptr, nullptr, 0 };
+
+			if (THREAD_CACHE)
+			{
+				std::lock_guard<std::mutex> guard(getPoolListLock());
+				m_next = getPoolList();
+				if (m_next)
+					m_next->m_prev = this;
+				getPoolList() = this;
+			}
+		}
+
+		SizeClassMemoryPool(const SizeClassMemoryPool&) = delete;
 
-			for (auto iter = begin_iter; iter != end_iter; ++iter)
+		~SizeClassMemoryPool()
+		{
+			if (THREAD_CACHE)
+			{
+				std::lock_guard<std::mutex> guard(getPoolListLock());
+				if (m_prev)
+					m_prev->m_next = m_next;
+				else
+					getPoolList() = m_next;
+				if (m_next)
+					m_next->m_prev = m_prev;
+			}
+		}
+
+		SizeClassMemoryPool& operator=(const SizeClassMemoryPool&) = delete;
+
+		virtual void* allocate(size_t bytes)
+		{
+			if (bytes == 0)
+				bytes = 1;
+
+			void* ptr;
+			size_t block_size;
+
+			if (bytes > MAX_CLASS_SIZE)
 			{
-				if (*iter == current_chunk_pos + current_chunk_size)
+				std::lock_guard<Lock> guard(m_lock);
+				ptr = allocatePages(bytes);
+				block_size = getPageCount(bytes) * PAGE_SIZE;
+
+				if (!ptr)
+					throw std::bad_alloc();
+			}
+			else
+			{
+				size_t class_index = getClass(bytes);
+				block_size = m_classes[class_index].block_size;
+
+				if (THREAD_CACHE)
 				{
-					++current_chunk_size;
-					if (current_chunk_size == chunks)
+					Magazine* magazine = getMagazine();
+					size_t& count = magazine->counts[class_index];
+
+					if (count == 0)
 					{
-						for (size_t i = current_chunk_pos; i < current_chunk_pos + current_chunk_size; ++i)
+						std::lock_guard<Lock> guard(m_lock);
+						while (count < MAGAZINE_SIZE / 2)
 						{
-							m_chunks.set(i);
+							void* block = allocateBlock(class_index);
+							if (!block)
+								break;
+
+							magazine->blocks[class_index][count++] = block;
+							m_cached += block_size;
 						}
-						return m_memory + (current_chunk_pos * ALIGNMENT);
 					}
+
+					if (count == 0)
+						throw std::bad_alloc();
+
+					ptr = magazine->blocks[class_index][--count];
+					m_cached -= block_size;
 				}
 				else
 				{
-					current_chunk_pos = *iter;
-					current_chunk_size = 1;
+					std::lock_guard<Lock> guard(m_lock);
+					ptr = allocateBlock(class_index);
+
+					if (!ptr)
+						throw std::bad_alloc();
 				}
 			}
 
-			throw std::bad_alloc();
+			m_requested += bytes;
+			size_t used = (m_used += block_size);
+			size_t high_water = m_high_water.load(std::memory_order_relaxed);
+			while (used > high_water && !m_high_water.compare_exchange_weak(high_water, used, std::memory_order_relaxed));
+
+			return ptr;
 		}
 
 		virtual void deallocate(void* ptr, size_t bytes)
 		{
-			std::lock_guard<Lock> guard(m_lock);
+			if (bytes == 0)
+				bytes = 1;
 
-			const size_t chunks = ((bytes - 1) / ALIGNMENT) + 1;
-			const size_t starting_chunk = (static_cast<char*>(ptr) - m_memory) / ALIGNMENT;
+			size_t block_size;
 
-			for (size_t i = starting_chunk; i < starting_chunk + chunks; ++i)
+			if (bytes > MAX_CLASS_SIZE)
 			{
-				m_chunks.unset(i);
+				std::lock_guard<Lock> guard(m_lock);
+				deallocatePages(ptr, bytes);
+				block_size = getPageCount(bytes) * PAGE_SIZE;
 			}
+			else
+			{
+				size_t class_index = getClass(bytes);
+				block_size = m_classes[class_index].block_size;
+
+				if (THREAD_CACHE)
+				{
+					Magazine* magazine = getMagazine();
+					size_t& count = magazine->counts[class_index];
+
+					magazine->blocks[class_index][count++] = ptr;
+					m_cached += block_size;
+
+					if (count == MAGAZINE_SIZE)
+					{
+						std::lock_guard<Lock> guard(m_lock);
+						for (; count > MAGAZINE_SIZE / 2; --count)
+							deallocateBlock(class_index, magazine->blocks[class_index][count - 1]);
+
+						m_cached -= (MAGAZINE_SIZE / 2) * block_size;
+					}
+				}
+				else
+				{
+					std::lock_guard<Lock> guard(m_lock);
+					deallocateBlock(class_index, ptr);
+				}
+			}
+
+			m_requested -= bytes;
+			m_used -= block_size;
 		}
 
 		virtual size_t getFreeMemory() const
 		{
-			return (m_chunks.falsebits().count() * ALIGNMENT);
+			MemoryPoolStats stats = getStats();
+			return (stats.class_free + stats.page_free);
 		}
 
 		virtual size_t getUsedMemory() const
 		{
-			return (m_chunks.truebits().count() * ALIGNMENT);
+			return m_used;
+		}
+
+		MemoryPoolStats getStats() const
+		{
+			std::lock_guard<Lock> guard(m_lock);
+
+			MemoryPoolStats stats;
+			stats.used = m_used;
+			stats.requested = m_requested;
+			stats.high_water = m_high_water;
+			stats.class_free = m_cached;
+			stats.page_free = m_pages.falsebits().count() * PAGE_SIZE;
+
+			for (auto& size_class : m_classes)
+				stats.class_free += size_class.free_count * size_class.block_size;
+
+			return stats;
 		}
 
 	private:
+		static constexpr size_t ALIGNMENT = 16;
+		static constexpr size_t CLASS_COUNT = 16;
+		static constexpr size_t PAGE_COUNT = SIZE / PAGE_SIZE;
+
 		struct DummyMutex
 		{
 			void lock() {};
@@ -137,9 +357,184 @@ namespace raz
 
 		typedef std::conditional_t<std::is_same<Mutex, void>::value, DummyMutex, Mutex> Lock;
 
-		Bitset<SIZE / ALIGNMENT> m_chunks;
-		Lock m_lock;
-		char m_memory[SIZE];
+		struct Block
+		{
+			Block* next;
+		};
+
+		struct SizeClass
+		{
+			size_t block_size;
+			Block* free_list;
+			char* bump;     // not yet used part of the newest page
+			char* bump_end;
+			size_t free_count; // blocks in free_list and bump
+		};
+
+		struct Magazine
+		{
+			SizeClassMemoryPool* pool;
+			size_t owner;
+			size_t counts[CLASS_COUNT];
+			void* blocks[CLASS_COUNT][MAGAZINE_SIZE];
+
+			~Magazine()
+			{
+				flushMagazine(*this);
+			}
+		};
+
+		const size_t m_id;
+		mutable Lock m_lock;
+		std::atomic<size_t> m_used;
+		std::atomic<size_t> m_requested;
+		std::atomic<size_t> m_high_water;
+		std::atomic<size_t> m_cached; // bytes in the magazines of threads
+		SizeClassMemoryPool* m_prev; // live pools of this type, see flushMagazine
+		SizeClassMemoryPool* m_next;
+		uint8_t m_class_lookup[MAX_CLASS_SIZE / ALIGNMENT + 1];
+		SizeClass m_classes[CLASS_COUNT];
+		Bitset<PAGE_COUNT> m_pages;
+		alignas(16) char m_memory[SIZE];
+
+		static size_t nextPoolId()
+		{
+			static std::atomic<size_t> next_id(1);
+			return next_id++;
+		}
+
+		static size_t getPageCount(size_t bytes)
+		{
+			return ((bytes - 1) / PAGE_SIZE) + 1;
+		}
+
+		size_t getClass(size_t bytes) const
+		{
+			return m_class_lookup[(bytes + ALIGNMENT - 1) / ALIGNMENT];
+		}
+
+		static std::mutex& getPoolListLock()
+		{
+			static std::mutex lock;
+			return lock;
+		}
+
+		static SizeClassMemoryPool*& getPoolList()
+		{
+			static SizeClassMemoryPool* pools = nullptr;
+			return pools;
+		}
+
+		// there is one magazine per thread and pool type, switching pools flushes it first
+		Magazine* getMagazine()
+		{
+			static thread_local Magazine magazine;
+
+			if (magazine.owner != m_id)
+			{
+				flushMagazine(magazine);
+				magazine.pool = this;
+				magazine.owner = m_id;
+			}
+
+			return &magazine;
+		}
+
+		// gives the cached blocks back to their pool, they are dropped if the pool is already destroyed
+		static void flushMagazine(Magazine& magazine)
+		{
+			if (magazine.owner != 0)
+			{
+				std::lock_guard<std::mutex> list_guard(getPoolListLock());
+
+				SizeClassMemoryPool* pool = getPoolList();
+				while (pool && (pool != magazine.pool || pool->m_id != magazine.owner))
+					pool = pool->m_next;
+
+				if (pool)
+				{
+					std::lock_guard<Lock> guard(pool->m_lock);
+					size_t bytes = 0;
+
+					for (size_t i = 0; i < CLASS_COUNT; ++i)
+					{
+						for (size_t n = 0; n < magazine.counts[i]; ++n)
+							pool->deallocateBlock(i, magazine.blocks[i][n]);
+
+						bytes += magazine.counts[i] * pool->m_classes[i].block_size;
+					}
+
+					pool->m_cached -= bytes;
+				}
+			}
+
+			magazine.pool = nullptr;
+			magazine.owner = 0;
+			std::memset(magazine.counts, 0, sizeof(magazine.counts));
+		}
+
+		// the caller holds the lock, returns nullptr if the pool is full
+		void* allocateBlock(size_t class_index)
+		{
+			SizeClass& size_class = m_classes[class_index];
+
+			if (size_class.free_list)
+			{
+				Block* block = size_class.free_list;
+				size_class.free_list = block->next;
+				--size_class.free_count;
+				return block;
+			}
+
+			if (size_class.bump == size_class.bump_end)
+			{
+				char* page = static_cast<char*>(allocatePages(PAGE_SIZE));
+				if (!page)
+					return nullptr;
+
+				size_class.bump = page;
+				size_class.bump_end = size_class.bump + (PAGE_SIZE / size_class.block_size) * size_class.block_size;
+				size_class.free_count += PAGE_SIZE / size_class.block_size;
+			}
+
+			void* ptr = size_class.bump;
+			size_class.bump += size_class.block_size;
+			--size_class.free_count;
+			return ptr;
+		}
+
+		void deallocateBlock(size_t class_index, void* ptr)
+		{
+			SizeClass& size_class = m_classes[class_index];
+
+			Block* block = static_cast<Block*>(ptr);
+			block->next = size_class.free_list;
+			size_class.free_list = block;
+			++size_class.free_count;
+		}
+
+		void* allocatePages(size_t bytes)
+		{
+			const size_t pages = getPageCount(bytes);
+			const size_t page_pos = m_pages.findFalseBits(pages);
+
+			if (page_pos == PAGE_COUNT)
+				return nullptr;
+
+			for (size_t i = page_pos; i < page_pos + pages; ++i)
+				m_pages.set(i);
+
+			return m_memory + (page_pos * PAGE_SIZE);
+		}
+
+		void deallocatePages(void* ptr, size_t bytes)
+		{
+			const size_t pages = getPageCount(bytes);
+			const size_t page_pos = (static_cast<char*>(ptr) - m_memory) / PAGE_SIZE;
+
+			for (size_t i = page_pos; i < page_pos + pages; ++i)
+				m_pages.unset(i);
+		}
 	};
 
 	template<class T>
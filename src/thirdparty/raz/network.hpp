@@ -21,9 +21,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
+#include <deque>
 #include <exception>
+#include <memory>
 #include <type_traits>
 #include "raz/serialization.hpp"
 
@@ -39,6 +43,11 @@ namespace raz
 		{
 			PacketType packet_type;
 			uint32_t packet_size;
+			uint32_t flags;     // see ReliableChannel
+			uint16_t sequence;  // see ReliableChannel
+			uint16_t ack;       // see ReliableChannel
+			uint32_t ack_bits;  // see ReliableChannel
+			uint64_t session_token; // assigned by the server, 0 before the handshake
 		};
 
 		struct Tail
@@ -60,6 +69,11 @@ namespace raz
 		{
 			m_data.head.packet_type = type;
 			m_data.head.packet_size = 0;
+			m_data.head.flags = 0;
+			m_data.head.sequence = 0;
+			m_data.head.ack = 0;
+			m_data.head.ack_bits = 0;
+			m_data.head.session_token = 0;
 		}
 
 		PacketBuffer(const PacketBuffer&) = delete;
@@ -119,10 +133,26 @@ namespace raz
 			return len;
 		}
 
+		// returns len bytes in place and skips them, or nullptr if there are not enough
+		const char* view(size_t len)
+		{
+			if (m_data.head.packet_size - m_data_pos < len)
+				return nullptr;
+
+			const char* ptr = &m_data.data[m_data_pos];
+			m_data_pos += len;
+			return ptr;
+		}
+
 		void reset()
 		{
 			m_data.head.packet_type = 0;
 			m_data.head.packet_size = 0;
+			m_data.head.flags = 0;
+			m_data.head.sequence = 0;
+			m_data.head.ack = 0;
+			m_data.head.ack_bits = 0;
+			m_data.head.session_token = 0;
 			m_data_pos = 0;
 		}
 
@@ -153,6 +183,322 @@ namespace raz
 		}
 	};
 
+	/*
+	 * Optional reliability on top of an unreliable (UDP) connection, one channel per peer.
+	 * Packets sent as reliable get a sequence number and are resent until the peer acks them,
+	 * then the peer delivers them in order. Every packet going through the channel carries
+	 * the last reliable sequence received and a bitfield of the 32 before it, so acks ride
+	 * along the regular traffic and a separate ack packet is only sent when there is none.
+	 * Unreliable packets are not stored and are delivered as they come.
+	 */
+	template<size_t SIZE, size_t WINDOW = 32>
+	class ReliableChannel
+	{
+	public:
+		static_assert(WINDOW > 0 && WINDOW <= 32 && (WINDOW & (WINDOW - 1)) == 0, "WINDOW should be a power of 2 covered by the ack bitfield");
+
+		enum Flags : uint32_t
+		{
+			RELIABLE = 1,
+			HAS_ACK = 2
+		};
+
+		static constexpr PacketType ACK_PACKET_TYPE = 0; // packet without payload, only carries acks
+
+		ReliableChannel() :
+			m_local_sequence(0),
+			m_remote_sequence(0),
+			m_remote_bits(0),
+			m_next_delivery(0),
+			m_has_remote(false),
+			m_ack_pending(false),
+			m_rtt_ms(100.f),
+			m_resends(0)
+		{
+			for (auto& entry : m_sent)
+				entry.used = false;
+
+			for (auto& entry : m_received)
+				entry.used = false;
+		}
+
+		ReliableChannel(const ReliableChannel&) = delete;
+
+		template<class Packet, class SendFunc>
+		void send(Packet& packet, bool reliable, SendFunc send_func)
+		{
+			auto* pdata = packet.getPacketData();
+
+			if (!reliable)
+			{
+				pdata->head.flags = 0;
+				stampAck(pdata->head);
+				send_func(packet);
+				return;
+			}
+
+			if (!m_backlog.empty() || m_sent[m_local_sequence % WINDOW].used)
+			{
+				// too many packets on the way, this one has to wait for a free slot
+				m_backlog.emplace_back(new PacketData());
+				copyPacketData(*m_backlog.back(), *pdata);
+				return;
+			}
+
+			sendReliable(packet, send_func);
+		}
+
+		// processes the acks of the packet and returns true if it should be handled right now
+		template<class Packet>
+		bool receive(Packet& packet)
+		{
+			auto* pdata = packet.getPacketData();
+
+			if (pdata->head.flags & HAS_ACK)
+				processAck(pdata->head.ack, pdata->head.ack_bits);
+
+			if ((pdata->head.flags & RELIABLE) == 0)
+				return (pdata->head.packet_type != ACK_PACKET_TYPE || pdata->head.packet_size > 0);
+
+			uint16_t sequence = pdata->head.sequence;
+			uint16_t distance = sequence - m_next_delivery;
+
+			m_ack_pending = true; // even duplicates, our previous ack might have been lost
+
+			if (distance >= 0x8000)
+				return false; // already delivered
+
+			if (distance >= WINDOW)
+				return false; // too far ahead, the sender will try again
+
+			recordReceived(sequence);
+
+			if (distance == 0)
+			{
+				++m_next_delivery;
+				return true;
+			}
+
+			ReceivedEntry& entry = m_received[sequence % WINDOW];
+			if (!entry.used)
+			{
+				entry.used = true;
+				entry.sequence = sequence;
+				copyPacketData(entry.data, *pdata);
+			}
+
+			return false;
+		}
+
+		// returns the reliable packets that were waiting for an earlier one, call it after receive()
+		template<class Packet>
+		bool popReady(Packet& packet)
+		{
+			ReceivedEntry& entry = m_received[m_next_delivery % WINDOW];
+			if (!entry.used || entry.sequence != m_next_delivery)
+				return false;
+
+			entry.used = false;
+			packet.reset();
+			copyPacketData(*packet.getPacketData(), entry.data);
+			++m_next_delivery;
+			return true;
+		}
+
+		// resends the packets that were not acked in time and sends pending acks, call it periodically
+		template<class SendFunc>
+		void update(SendFunc send_func)
+		{
+			auto now = std::chrono::steady_clock::now();
+			auto resend_timeout = std::chrono::milliseconds((std::chrono::milliseconds::rep)getResendTimeout());
+
+			for (auto& entry : m_sent)
+			{
+				if (!entry.used || now - entry.sent_time < resend_timeout)
+					continue;
+
+				copyPacketData(*m_packet.getPacketData(), entry.data);
+				stampAck(m_packet.getPacketData()->head);
+				send_func(m_packet);
+
+				entry.sent_time = now;
+				entry.resent = true;
+				++m_resends;
+			}
+
+			while (!m_backlog.empty() && !m_sent[m_local_sequence % WINDOW].used)
+			{
+				copyPacketData(*m_packet.getPacketData(), *m_backlog.front());
+				m_backlog.pop_front();
+				sendReliable(m_packet, send_func);
+			}
+
+			if (m_ack_pending)
+			{
+				m_packet.reset();
+				m_packet.setType(ACK_PACKET_TYPE);
+				stampAck(m_packet.getPacketData()->head);
+				send_func(m_packet);
+			}
+		}
+
+		size_t getUnackedCount() const
+		{
+			size_t count = m_backlog.size();
+
+			for (auto& entry : m_sent)
+			{
+				if (entry.used)
+					++count;
+			}
+
+			return count;
+		}
+
+		uint64_t getResendCount() const
+		{
+			return m_resends;
+		}
+
+		float getRoundTripTime() const
+		{
+			return m_rtt_ms;
+		}
+
+	private:
+		typedef typename PacketBuffer<SIZE>::PacketData PacketData;
+
+		struct SentEntry
+		{
+			bool used;
+			bool resent;
+			uint16_t sequence;
+			std::chrono::steady_clock::time_point sent_time;
+			PacketData data;
+		};
+
+		struct ReceivedEntry
+		{
+			bool used;
+			uint16_t sequence;
+			PacketData data;
+		};
+
+		SentEntry m_sent[WINDOW];
+		ReceivedEntry m_received[WINDOW];
+		std::deque<std::unique_ptr<PacketData>> m_backlog;
+		Packet<SIZE> m_packet;
+		uint16_t m_local_sequence;
+		uint16_t m_remote_sequence;
+		uint32_t m_remote_bits;
+		uint16_t m_next_delivery;
+		bool m_has_remote;
+		bool m_ack_pending;
+		float m_rtt_ms;
+		uint64_t m_resends;
+
+		static void copyPacketData(PacketData& dest, const PacketData& src)
+		{
+			std::memcpy(&dest.head, &src.head, sizeof(src.head));
+			std::memcpy(dest.data, src.data, src.head.packet_size);
+		}
+
+		float getResendTimeout() const
+		{
+			return std::max(2.f * m_rtt_ms, 20.f);
+		}
+
+		template<class Packet, class SendFunc>
+		void sendReliable(Packet& packet, SendFunc send_func)
+		{
+			auto* pdata = packet.getPacketData();
+			pdata->head.flags = RELIABLE;
+			pdata->head.sequence = m_local_sequence;
+			stampAck(pdata->head);
+
+			SentEntry& entry = m_sent[m_local_sequence % WINDOW];
+			entry.used = true;
+			entry.resent = false;
+			entry.sequence = m_local_sequence;
+			entry.sent_time = std::chrono::steady_clock::now();
+			copyPacketData(entry.data, *pdata);
+
+			++m_local_sequence;
+			send_func(packet);
+		}
+
+		template<class Head>
+		void stampAck(Head& head)
+		{
+			if (m_has_remote)
+			{
+				head.flags |= HAS_ACK;
+				head.ack = m_remote_sequence;
+				head.ack_bits = m_remote_bits;
+			}
+
+			m_ack_pending = false;
+		}
+
+		void recordReceived(uint16_t sequence)
+		{
+			if (!m_has_remote)
+			{
+				m_has_remote = true;
+				m_remote_sequence = sequence;
+				m_remote_bits = 0;
+				return;
+			}
+
+			uint16_t distance = sequence - m_remote_sequence;
+
+			if (distance == 0)
+			{
+				return;
+			}
+			else if (distance < 0x8000) // newer
+			{
+				m_remote_bits = (distance < 32) ? (m_remote_bits << distance) : 0;
+				if (distance <= 32)
+					m_remote_bits |= (1u << (distance - 1)); // the previous remote sequence
+				m_remote_sequence = sequence;
+			}
+			else // older
+			{
+				uint16_t age = m_remote_sequence - sequence;
+				if (age <= 32)
+					m_remote_bits |= (1u << (age - 1));
+			}
+		}
+
+		void processAck(uint16_t ack, uint32_t ack_bits)
+		{
+			acked(ack);
+
+			for (uint16_t i = 0; i < 32; ++i)
+			{
+				if (ack_bits & (1u << i))
+					acked(ack - 1 - i);
+			}
+		}
+
+		void acked(uint16_t sequence)
+		{
+			SentEntry& entry = m_sent[sequence % WINDOW];
+			if (!entry.used || entry.sequence != sequence)
+				return;
+
+			entry.used = false;
+
+			// resent packets don't tell which copy got acked
+			if (!entry.resent)
+			{
+				float sample = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - entry.sent_time).count();
+				m_rtt_ms += 0.125f * (sample - m_rtt_ms);
+			}
+		}
+	};
+
 	template<class ClientBackend>
 	class NetworkClient
 	{
@@ -270,6 +616,13 @@ namespace raz
 
 		template<class Packet>
 		void send(const Client& client, Packet& packet)
+		{
+			send(client, packet, m_backend);
+		}
+
+		// writer can be anything with the same write(client, ptr, len) as the backend, like a queue of outgoing packets
+		template<class Packet, class Writer>
+		void send(const Client& client, Packet& packet, Writer& writer)
 		{
 			Packet::PacketData* pdata = packet.getPacketData();
 
@@ -277,7 +630,7 @@ namespace raz
 			if (reinterpret_cast<const char*>(&pdata->tail) != &pdata->data[pdata->head.packet_size])
 				std::memcpy(&pdata->data[pdata->head.packet_size], &pdata->tail, sizeof(pdata->tail));
 
-			m_backend.write(client, reinterpret_cast<const char*>(pdata), sizeof(pdata->head) + pdata->head.packet_size + sizeof(pdata->tail));
+			writer.write(client, reinterpret_cast<const char*>(pdata), sizeof(pdata->head) + pdata->head.packet_size + sizeof(pdata->tail));
 		}
 
 		ServerBackend& getBackend()
@@ -26,6 +26,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #include <winsock2.h>
 #include <ws2tcpip.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <exception>
@@ -69,6 +72,182 @@ namespace raz
 		NetworkInitializer(const NetworkInitializer&) = delete;
 	};
 
+	/*
+	 * Waits on a socket, a periodic timer and a wake-up event at the same time, so a
+	 * single blocking call serves inbound packets, on-schedule ticks and outbound work.
+	 * The timer is checked first, so a busy socket can't delay the ticks.
+	 */
+	class NetworkReactor
+	{
+	public:
+		enum Event
+		{
+			TIMEOUT,
+			TIMER_EXPIRED,
+			SOCKET_READABLE,
+			WOKEN_UP
+		};
+
+		struct TimerStats
+		{
+			uint64_t ticks;
+			float mean_jitter_ms; // average difference between the period and the actual tick interval
+			float max_jitter_ms;
+		};
+
+		NetworkReactor() :
+			m_socket(INVALID_SOCKET),
+			m_timer_period(0),
+			m_timer_expired(false),
+			m_ticks(0),
+			m_jitter_sum(0.f),
+			m_max_jitter(0.f)
+		{
+			m_events[TIMER_INDEX] = CreateWaitableTimer(NULL, FALSE, NULL);
+			m_events[SOCKET_INDEX] = WSACreateEvent();
+			m_events[WAKE_INDEX] = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+			if (!m_events[TIMER_INDEX] || m_events[SOCKET_INDEX] == WSA_INVALID_EVENT || !m_events[WAKE_INDEX])
+				throw NetworkSocketError();
+		}
+
+		~NetworkReactor()
+		{
+			CloseHandle(m_events[TIMER_INDEX]);
+			WSACloseEvent(m_events[SOCKET_INDEX]);
+			CloseHandle(m_events[WAKE_INDEX]);
+		}
+
+		NetworkReactor(const NetworkReactor&) = delete;
+
+		NetworkReactor& operator=(const NetworkReactor&) = delete;
+
+		// note: makes the socket non-blocking
+		void watch(SOCKET socket)
+		{
+			m_socket = socket;
+
+			if (WSAEventSelect(m_socket, m_events[SOCKET_INDEX], FD_READ) == SOCKET_ERROR)
+				throw NetworkSocketError();
+		}
+
+		void unwatch()
+		{
+			if (m_socket != INVALID_SOCKET)
+				WSAEventSelect(m_socket, NULL, 0);
+
+			WSAResetEvent(m_events[SOCKET_INDEX]);
+			m_socket = INVALID_SOCKET;
+		}
+
+		// the timer fires every period_ms milliseconds regardless of how long handling the ticks takes
+		void setTimer(uint32_t period_ms)
+		{
+			m_timer_period = period_ms;
+			m_timer_expired = false;
+			m_ticks = 0;
+			m_jitter_sum = 0.f;
+			m_max_jitter = 0.f;
+
+			if (period_ms == 0)
+			{
+				CancelWaitableTimer(m_events[TIMER_INDEX]);
+				return;
+			}
+
+			LARGE_INTEGER due_time;
+			due_time.QuadPart = -(LONGLONG)period_ms * 10000; // relative, in 100ns units
+
+			if (!SetWaitableTimer(m_events[TIMER_INDEX], &due_time, (LONG)period_ms, NULL, NULL, FALSE))
+				throw NetworkSocketError();
+
+			m_last_tick = std::chrono::steady_clock::now();
+		}
+
+		// thread-safe, interrupts a pending wait()
+		void wakeUp()
+		{
+			SetEvent(m_events[WAKE_INDEX]);
+		}
+
+		Event wait(uint32_t timeout_ms)
+		{
+			DWORD rc = WSAWaitForMultipleEvents(EVENT_COUNT, m_events, FALSE, timeout_ms, FALSE);
+
+			switch (rc)
+			{
+			case WSA_WAIT_EVENT_0 + TIMER_INDEX:
+				tick();
+				return TIMER_EXPIRED;
+
+			case WSA_WAIT_EVENT_0 + SOCKET_INDEX:
+			{
+				// resets the event, the next recv re-signals it if there is more data
+				WSANETWORKEVENTS network_events;
+				WSAEnumNetworkEvents(m_socket, m_events[SOCKET_INDEX], &network_events);
+				return SOCKET_READABLE;
+			}
+
+			case WSA_WAIT_EVENT_0 + WAKE_INDEX:
+				return WOKEN_UP;
+
+			case WSA_WAIT_TIMEOUT:
+				return TIMEOUT;
+
+			default:
+				throw NetworkSocketError();
+			}
+		}
+
+		// returns true once for every tick since the last call
+		bool consumeTimer()
+		{
+			bool expired = m_timer_expired;
+			m_timer_expired = false;
+			return expired;
+		}
+
+		TimerStats getTimerStats() const
+		{
+			TimerStats stats;
+			stats.ticks = m_ticks;
+			stats.mean_jitter_ms = m_ticks ? (m_jitter_sum / m_ticks) : 0.f;
+			stats.max_jitter_ms = m_max_jitter;
+			return stats;
+		}
+
+	private:
+		enum
+		{
+			TIMER_INDEX, // lowest index wins if several events are signaled
+			SOCKET_INDEX,
+			WAKE_INDEX,
+			EVENT_COUNT
+		};
+
+		SOCKET m_socket;
+		HANDLE m_events[EVENT_COUNT];
+		uint32_t m_timer_period;
+		bool m_timer_expired;
+		std::chrono::steady_clock::time_point m_last_tick;
+		uint64_t m_ticks;
+		float m_jitter_sum;
+		float m_max_jitter;
+
+		void tick()
+		{
+			auto now = std::chrono::steady_clock::now();
+			float interval = std::chrono::duration<float, std::milli>(now - m_last_tick).count();
+			float jitter = std::abs(interval - (float)m_timer_period);
+
+			m_last_tick = now;
+			m_timer_expired = true;
+			++m_ticks;
+			m_jitter_sum += jitter;
+			m_max_jitter = std::max(m_max_jitter, jitter);
+		}
+	};
+
 
 	/*
 	 * TCP CLIENT AND SERVER BACKENDS
@@ -550,34 +729,26 @@ namespace raz
 				return false;
 			}
 
+			m_reactor.watch(m_socket);
 			return true;
 		}
 
 		size_t wait(uint32_t timeous_ms)
 		{
-			fd_set set;
-			FD_ZERO(&set);
-			FD_SET(m_socket, &set);
-
-			struct timeval timeout;
-			timeout.tv_sec = timeous_ms / 1000;
-			timeout.tv_usec = (timeous_ms % 1000) * 1000;
-
-			int rc = select(m_socket + 1, &set, NULL, NULL, &timeout);
-			if (rc == SOCKET_ERROR)
+			if (m_reactor.wait(timeous_ms) != NetworkReactor::SOCKET_READABLE)
 			{
-				throw NetworkSocketError();
-			}
-			else if (rc > 0)
-			{
-				m_data_len = recv(m_socket, m_data, BUF_SIZE, 0);
-				m_data_pos = 0;
-				return m_data_len;
+				return 0;
 			}
-			else
+
+			int rc = recv(m_socket, m_data, BUF_SIZE, 0);
+			if (rc == SOCKET_ERROR)
 			{
-				return 0;
+				return 0; // would block, or the server is unreachable (timeouts handle that)
 			}
+
+			m_data_len = static_cast<size_t>(rc);
+			m_data_pos = 0;
+			return m_data_len;
 		}
 
 		size_t peek(char* ptr, size_t len)
@@ -610,6 +781,9 @@ namespace raz
 			int rc = sendto(m_socket, ptr, len, 0, reinterpret_cast<const struct sockaddr*>(&m_sockaddr), sizeof(SOCKADDR_STORAGE));
 			if (rc == SOCKET_ERROR)
 			{
+				if (WSAGetLastError() == WSAEWOULDBLOCK)
+					return 0; // send buffer is full, the datagram is dropped
+
 				throw NetworkSocketError();
 			}
 			else
@@ -620,11 +794,18 @@ namespace raz
 
 		void close()
 		{
+			m_reactor.unwatch();
 			closesocket(m_socket);
 			m_socket = INVALID_SOCKET;
 		}
 
+		NetworkReactor& getReactor()
+		{
+			return m_reactor;
+		}
+
 	private:
+		NetworkReactor m_reactor;
 		SOCKET m_socket;
 		SOCKADDR_STORAGE m_sockaddr;
 		size_t m_data_len;
@@ -732,31 +913,19 @@ namespace raz
 				return false;
 			}
 
+			m_reactor.watch(m_socket);
 			return true;
 		}
 
 		size_t wait(Client& client, ClientState& state, uint32_t timeous_ms)
 		{
-			fd_set set;
-			FD_ZERO(&set);
-			FD_SET(m_socket, &set);
-
-			struct timeval timeout;
-			timeout.tv_sec = timeous_ms / 1000;
-			timeout.tv_usec = (timeous_ms % 1000) * 1000;
-
-			int rc = select(m_socket + 1, &set, NULL, NULL, &timeout);
-			if (rc == SOCKET_ERROR)
-			{
-				throw NetworkSocketError();
-			}
-			else if (rc > 0)
+			if (m_reactor.wait(timeous_ms) == NetworkReactor::SOCKET_READABLE)
 			{
 				int addrlen = sizeof(client.sockaddr);
 				int rc = recvfrom(m_socket, m_data, BUF_SIZE, 0, reinterpret_cast<struct sockaddr*>(&client.sockaddr), &addrlen);
 				if (rc == SOCKET_ERROR)
 				{
-					state = ClientState::CLIENT_UNAVAILABLE;
+					state = (WSAGetLastError() == WSAEWOULDBLOCK) ? ClientState::UNSET : ClientState::CLIENT_UNAVAILABLE;
 					return 0;
 				}
 
@@ -812,6 +981,9 @@ namespace raz
 			int rc = sendto(m_socket, ptr, len, 0, reinterpret_cast<const struct sockaddr*>(&client.sockaddr), sizeof(client.sockaddr));
 			if (rc == SOCKET_ERROR)
 			{
+				if (WSAGetLastError() == WSAEWOULDBLOCK)
+					return 0; // send buffer is full, the datagram is dropped
+
 				throw NetworkSocketError();
 			}
 			else
@@ -822,11 +994,18 @@ namespace raz
 
 		void close()
 		{
+			m_reactor.unwatch();
 			closesocket(m_socket);
 			m_socket = INVALID_SOCKET;
 		}
 
+		NetworkReactor& getReactor()
+		{
+			return m_reactor;
+		}
+
 	private:
+		NetworkReactor m_reactor;
 		SOCKET m_socket;
 		SOCKADDR_STORAGE m_sockaddr;
 		Client m_last_client;
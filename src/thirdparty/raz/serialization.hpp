@@ -23,6 +23,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #include <array>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <vector>
 #include <type_traits>
@@ -44,6 +47,73 @@ namespace raz
 		DESERIALIZE
 	};
 
+	/*
+	Specialize for trivially copyable types without padding that serialize all of
+	their fields in declaration order. These are copied in one piece when the wire
+	format matches the host layout, and field by field otherwise.
+	*/
+	template<class T>
+	struct IsBitwiseSerializable : std::false_type
+	{
+	};
+
+	/*
+	LEB128 encoding of an integer, signed integers are zigzag encoded first
+	*/
+	template<class I>
+	struct Varint
+	{
+		static_assert(std::is_integral<I>::value, "Varint needs an integral type");
+
+		I& value;
+	};
+
+	template<class I>
+	Varint<I> varint(I& value)
+	{
+		return{ value };
+	}
+
+	/*
+	UTF-32 string sent as UTF-8 with a varint byte length, at most max_length code points
+	*/
+	template<class String>
+	struct UTF8
+	{
+		static_assert(sizeof(typename String::value_type) == 4, "UTF8 needs a UTF-32 string");
+
+		String& str;
+		size_t max_length;
+	};
+
+	template<class CharType, class Allocator>
+	UTF8<std::basic_string<CharType, std::char_traits<CharType>, Allocator>>
+		utf8(std::basic_string<CharType, std::char_traits<CharType>, Allocator>& str, size_t max_length = SIZE_MAX)
+	{
+		return{ str, max_length };
+	}
+
+	/*
+	Bytes with a varint length. When deserializing, data points into the buffer
+	instead of being copied, so the view is only valid until the buffer changes
+	*/
+	struct StringView
+	{
+		const char* data;
+		size_t length;
+	};
+
+	struct BoundedStringView
+	{
+		StringView& view;
+		size_t max_length;
+	};
+
+	inline BoundedStringView bounded(StringView& view, size_t max_length)
+	{
+		return{ view, max_length };
+	}
+
 	template<class BufferType, bool EndiannessConversion = false>
 	class Serializer : public BufferType
 	{
@@ -85,7 +155,14 @@ namespace raz
 
 		Serializer& operator()(float& f)
 		{
-			if (BufferType::getMode() == SerializationMode::SERIALIZE)
+			if (std::numeric_limits<float>::is_iec559)
+			{
+				uint32_t tmp;
+				std::memcpy(&tmp, &f, sizeof(float));
+				(*this)(tmp);
+				std::memcpy(&f, &tmp, sizeof(float));
+			}
+			else if (BufferType::getMode() == SerializationMode::SERIALIZE)
 			{
 				uint32_t tmp = static_cast<uint32_t>(pack754(f, 32, 8));
 				(*this)(tmp);
@@ -102,7 +179,14 @@ namespace raz
 
 		Serializer& operator()(double& d)
 		{
-			if (BufferType::getMode() == SerializationMode::SERIALIZE)
+			if (std::numeric_limits<double>::is_iec559)
+			{
+				uint64_t tmp;
+				std::memcpy(&tmp, &d, sizeof(double));
+				(*this)(tmp);
+				std::memcpy(&d, &tmp, sizeof(double));
+			}
+			else if (BufferType::getMode() == SerializationMode::SERIALIZE)
 			{
 				uint64_t tmp = pack754(d, 64, 11);
 				(*this)(tmp);
@@ -120,8 +204,23 @@ namespace raz
 		template<class T, size_t N>
 		Serializer& operator()(std::array<T, N>& arr)
 		{
-			for (auto& t : arr)
-				(*this)(t);
+			return (*this)(arr.data(), N);
+		}
+
+		template<class T>
+		Serializer& operator()(T* arr, size_t count)
+		{
+			if (IsBitwiseSerializable<T>::value && hasHostLayout())
+			{
+				copyBitwise(arr, count);
+			}
+			else
+			{
+				for (size_t i = 0; i < count; ++i)
+					(*this)(arr[i]);
+			}
+
+			return *this;
 		}
 
 		template<class CharType, class Allocator>
@@ -178,14 +277,266 @@ namespace raz
 			return *this;
 		}
 
+		template<class I>
+		Serializer& operator()(Varint<I> v)
+		{
+			typedef std::make_unsigned_t<I> U;
+
+			if (BufferType::getMode() == SerializationMode::SERIALIZE)
+			{
+				U tmp = zigzagEncode(v.value, std::is_signed<I>());
+
+				do
+				{
+					uint8_t byte = (uint8_t)(tmp & 0x7F);
+					tmp >>= 7;
+					if (tmp)
+						byte |= 0x80;
+					(*this)(byte);
+				} while (tmp);
+			}
+			else
+			{
+				U tmp = 0;
+				uint8_t byte;
+				unsigned shift = 0;
+
+				do
+				{
+					if (shift >= sizeof(I) * 8)
+						throw SerializationError();
+
+					(*this)(byte);
+
+					// the last group may only carry the bits that still fit in I
+					unsigned bits_left = sizeof(I) * 8 - shift;
+					if (bits_left < 7 && ((byte & 0x7F) >> bits_left) != 0)
+						throw SerializationError();
+
+					tmp |= (U)((U)(byte & 0x7F) << shift);
+					shift += 7;
+				} while (byte & 0x80);
+
+				v.value = zigzagDecode<I>(tmp, std::is_signed<I>());
+			}
+
+			return *this;
+		}
+
+		template<class String>
+		Serializer& operator()(UTF8<String> u)
+		{
+			if (BufferType::getMode() == SerializationMode::SERIALIZE)
+			{
+				if (u.str.length() > u.max_length)
+					throw SerializationError();
+
+				char buf[4];
+				uint32_t len = 0;
+
+				for (auto c : u.str)
+					len += encodeUTF8((uint32_t)c, buf);
+
+				(*this)(varint(len));
+
+				for (auto c : u.str)
+				{
+					size_t n = encodeUTF8((uint32_t)c, buf);
+					if (BufferType::write(buf, n) < n)
+						throw SerializationError();
+				}
+			}
+			else
+			{
+				StringView view;
+				(*this)(bounded(view, (u.max_length > SIZE_MAX / 4) ? SIZE_MAX : u.max_length * 4));
+
+				const char* end = view.data + view.length;
+				size_t count = 0;
+				uint32_t c;
+
+				for (const char* p = view.data; p < end; ++count)
+				{
+					if (!decodeUTF8(p, end, c))
+						throw SerializationError();
+				}
+
+				if (count > u.max_length)
+					throw SerializationError();
+
+				u.str.resize(count);
+
+				const char* p = view.data;
+				for (auto& ch : u.str)
+				{
+					decodeUTF8(p, end, c);
+					ch = (typename String::value_type)c;
+				}
+			}
+
+			return *this;
+		}
+
+		Serializer& operator()(BoundedStringView b)
+		{
+			uint32_t len = static_cast<uint32_t>(b.view.length);
+			(*this)(varint(len));
+
+			if (len > b.max_length)
+				throw SerializationError();
+
+			if (BufferType::getMode() == SerializationMode::SERIALIZE)
+			{
+				if (BufferType::write(b.view.data, len) < len)
+					throw SerializationError();
+			}
+			else
+			{
+				const char* data = BufferType::view(len);
+				if (!data)
+					throw SerializationError();
+
+				b.view.data = data;
+				b.view.length = len;
+			}
+
+			return *this;
+		}
+
+		template<class T>
+		typename std::enable_if_t<IsBitwiseSerializable<T>::value, Serializer>& operator()(T& t)
+		{
+			if (hasHostLayout())
+				copyBitwise(&t, 1);
+			else
+				t(*this);
+
+			return *this;
+		}
+
 		template<class T>
-		typename std::enable_if_t<!std::is_arithmetic<T>::value, Serializer>& operator()(T& t)
+		typename std::enable_if_t<!std::is_arithmetic<T>::value && !IsBitwiseSerializable<T>::value, Serializer>& operator()(T& t)
 		{
 			t(*this);
 			return *this;
 		}
 
 	private:
+		template<class I>
+		static std::make_unsigned_t<I> zigzagEncode(I i, std::true_type)
+		{
+			typedef std::make_unsigned_t<I> U;
+			return (U)((U)i << 1) ^ (U)(i >> (sizeof(I) * 8 - 1));
+		}
+
+		template<class I>
+		static I zigzagEncode(I i, std::false_type)
+		{
+			return i;
+		}
+
+		template<class I>
+		static I zigzagDecode(std::make_unsigned_t<I> u, std::true_type)
+		{
+			typedef std::make_unsigned_t<I> U;
+			return (I)((U)(u >> 1) ^ (U)(0 - (U)(u & 1)));
+		}
+
+		template<class I>
+		static I zigzagDecode(I u, std::false_type)
+		{
+			return u;
+		}
+
+		static size_t encodeUTF8(uint32_t c, char* buf)
+		{
+			if (c < 0x80)
+			{
+				buf[0] = (char)c;
+				return 1;
+			}
+			else if (c < 0x800)
+			{
+				buf[0] = (char)(0xC0 | (c >> 6));
+				buf[1] = (char)(0x80 | (c & 0x3F));
+				return 2;
+			}
+			else if (c < 0x10000)
+			{
+				if (c >= 0xD800 && c <= 0xDFFF)
+					throw SerializationError();
+
+				buf[0] = (char)(0xE0 | (c >> 12));
+				buf[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+				buf[2] = (char)(0x80 | (c & 0x3F));
+				return 3;
+			}
+			else if (c < 0x110000)
+			{
+				buf[0] = (char)(0xF0 | (c >> 18));
+				buf[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+				buf[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+				buf[3] = (char)(0x80 | (c & 0x3F));
+				return 4;
+			}
+
+			throw SerializationError();
+		}
+
+		// rejects truncated and overlong sequences, surrogates and code points above U+10FFFF
+		static bool decodeUTF8(const char*& p, const char* end, uint32_t& c)
+		{
+			uint8_t lead = (uint8_t)*p++;
+			size_t extra;
+			uint32_t min;
+
+			if (lead < 0x80) { c = lead; return true; }
+			else if ((lead & 0xE0) == 0xC0) { c = lead & 0x1F; extra = 1; min = 0x80; }
+			else if ((lead & 0xF0) == 0xE0) { c = lead & 0x0F; extra = 2; min = 0x800; }
+			else if ((lead & 0xF8) == 0xF0) { c = lead & 0x07; extra = 3; min = 0x10000; }
+			else return false;
+
+			if ((size_t)(end - p) < extra)
+				return false;
+
+			for (size_t i = 0; i < extra; ++i)
+			{
+				uint8_t byte = (uint8_t)*p++;
+				if ((byte & 0xC0) != 0x80)
+					return false;
+
+				c = (c << 6) | (byte & 0x3F);
+			}
+
+			return (c >= min && c < 0x110000 && (c < 0xD800 || c > 0xDFFF));
+		}
+
+		static bool hasHostLayout()
+		{
+			return ((!EndiannessConversion || isBigEndian())
+				&& std::numeric_limits<float>::is_iec559
+				&& std::numeric_limits<double>::is_iec559);
+		}
+
+		template<class T>
+		void copyBitwise(T* arr, size_t count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value && std::is_standard_layout<T>::value,
+				"Bitwise serializable types must be trivially copyable and have standard layout");
+
+			size_t len = count * sizeof(T);
+
+			if (BufferType::getMode() == SerializationMode::SERIALIZE)
+			{
+				if (BufferType::write(reinterpret_cast<const char*>(arr), len) < len)
+					throw SerializationError();
+			}
+			else
+			{
+				if (BufferType::read(reinterpret_cast<char*>(arr), len) < len)
+					throw SerializationError();
+			}
+		}
 		static constexpr bool isBigEndian()
 		{
 			union
@@ -197,21 +548,52 @@ namespace raz
 			return (chk.c[0] == 1);
 		}
 
+		static uint8_t byteSwap(uint8_t i)
+		{
+			return i;
+		}
+
+		static uint16_t byteSwap(uint16_t i)
+		{
+#ifdef _MSC_VER
+			return _byteswap_ushort(i);
+#else
+			return __builtin_bswap16(i);
+#endif
+		}
+
+		static uint32_t byteSwap(uint32_t i)
+		{
+#ifdef _MSC_VER
+			return _byteswap_ulong(i);
+#else
+			return __builtin_bswap32(i);
+#endif
+		}
+
+		static uint64_t byteSwap(uint64_t i)
+		{
+#ifdef _MSC_VER
+			return _byteswap_uint64(i);
+#else
+			return __builtin_bswap64(i);
+#endif
+		}
+
 		template<class T>
 		static T swapEndianness(T t)
 		{
-			union
-			{
-				T t;
-				unsigned char t8[sizeof(T)];
-			} source, dest;
-
-			source.t = t;
+			typedef std::conditional_t<sizeof(T) == 1, uint8_t,
+				std::conditional_t<sizeof(T) == 2, uint16_t,
+				std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>> U;
 
-			for (size_t i = 0; i < sizeof(T); i++)
-				dest.t8[i] = source.t8[sizeof(T) - i - 1];
+			static_assert(sizeof(T) == sizeof(U), "Unsupported size");
 
-			return dest.t;
+			U u;
+			std::memcpy(&u, &t, sizeof(T));
+			u = byteSwap(u);
+			std::memcpy(&t, &u, sizeof(T));
+			return t;
 		}
 
 #pragma warning(push)
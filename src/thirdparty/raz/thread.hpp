@@ -26,6 +26,9 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 #include <future>
 #include <mutex>
 #include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include "raz/memory.hpp"
 
@@ -42,6 +45,7 @@ namespace raz
 		// please note that IMemoryPool must be thread-safe
 		Thread(IMemoryPool* memory = nullptr) :
 			m_memory(memory),
+			m_object(nullptr),
 			m_exit_token(std::allocator_arg, raz::Allocator<int>(memory)),
 			m_thread_result(std::allocator_arg, raz::Allocator<int>(memory)),
 			m_call_queue(memory)
@@ -95,23 +99,225 @@ namespace raz
 			m_call_queue.clear();
 		}
 
+		// if T has a thread-safe wakeUp() member, it gets called so a blocking loop can return early
 		template<class... Args>
-		void operator()(Args... args)
+		void operator()(Args&&... args)
 		{
-			std::lock_guard<std::mutex> guard(m_mutex);
-			m_call_queue.emplace_back(std::allocator_arg, raz::Allocator<char>(m_memory), [args...](T& object) { object(args...); });
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				m_call_queue.push(std::forward<Args>(args)...);
+			}
+
+			wakeUp();
+		}
+
+		// one call per element, enqueued under a single lock with a single wake up (use std::move_iterator to move the elements)
+		template<class Iterator>
+		void batch(Iterator first, Iterator last)
+		{
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				for (; first != last; ++first)
+					m_call_queue.push(*first);
+			}
+
+			wakeUp();
 		}
 
 	private:
-		typedef std::function<void(T&)> ForwardedCall;
-		typedef std::vector<ForwardedCall, raz::Allocator<ForwardedCall>> ForwardedCallQueue;
+		/*
+		The arguments of each call are constructed in a bump arena and the queue keeps
+		typed handles to them. The consumer swaps the whole queue with its drained one,
+		so the arena chunks go back and forth between the two and are only rewound,
+		never freed, once they are big enough for a frame worth of calls.
+		*/
+		class CallQueue
+		{
+		public:
+			CallQueue(IMemoryPool* memory) :
+				m_memory(memory),
+				m_chunks(raz::Allocator<Chunk>(memory)),
+				m_calls(raz::Allocator<Call>(memory)),
+				m_chunk(0)
+			{
+			}
+
+			CallQueue(const CallQueue&) = delete;
+
+			CallQueue& operator=(const CallQueue&) = delete;
+
+			~CallQueue()
+			{
+				clear();
+
+				raz::Allocator<char> alloc(m_memory);
+				for (auto& chunk : m_chunks)
+					alloc.deallocate(chunk.data, chunk.size);
+			}
+
+			template<class... Args>
+			void push(Args&&... args)
+			{
+				typedef Payload<std::decay_t<Args>...> P;
+
+				void* ptr = allocate(sizeof(P), alignof(P));
+				P* payload = new (ptr) P(std::forward<Args>(args)...);
+				m_calls.push_back({ &P::invoke, &P::destroy, payload });
+			}
+
+			size_t size() const
+			{
+				return m_calls.size();
+			}
+
+			void invoke(size_t i, T& object)
+			{
+				m_calls[i].invoke(object, m_calls[i].payload);
+			}
+
+			// destroys the pending calls and rewinds the arena
+			void clear()
+			{
+				for (auto& call : m_calls)
+					call.destroy(call.payload);
+
+				m_calls.clear();
+
+				for (auto& chunk : m_chunks)
+					chunk.used = 0;
+
+				m_chunk = 0;
+			}
+
+			void swap(CallQueue& other)
+			{
+				std::swap(m_memory, other.m_memory);
+				m_chunks.swap(other.m_chunks);
+				m_calls.swap(other.m_calls);
+				std::swap(m_chunk, other.m_chunk);
+			}
+
+		private:
+			static constexpr size_t MIN_CHUNK_SIZE = 16 * 1024;
+
+			template<class... Args>
+			struct Payload
+			{
+				std::tuple<Args...> args;
+
+				template<class... U>
+				Payload(U&&... u) : args(std::forward<U>(u)...)
+				{
+				}
+
+				static void invoke(T& object, void* payload)
+				{
+					static_cast<Payload*>(payload)->call(object, std::index_sequence_for<Args...>{});
+				}
+
+				static void destroy(void* payload)
+				{
+					static_cast<Payload*>(payload)->~Payload();
+				}
+
+				template<size_t... I>
+				void call(T& object, std::index_sequence<I...>)
+				{
+					object(std::move(std::get<I>(args))...); // every call runs once
+				}
+			};
+
+			struct Call
+			{
+				void(*invoke)(T&, void*);
+				void(*destroy)(void*);
+				void* payload;
+			};
+
+			struct Chunk
+			{
+				char* data;
+				size_t size;
+				size_t used;
+			};
+
+			IMemoryPool* m_memory;
+			std::vector<Chunk, raz::Allocator<Chunk>> m_chunks;
+			std::vector<Call, raz::Allocator<Call>> m_calls;
+			size_t m_chunk; // the one being filled
+
+			void* allocate(size_t size, size_t alignment)
+			{
+				for (; m_chunk < m_chunks.size(); ++m_chunk)
+				{
+					Chunk& chunk = m_chunks[m_chunk];
+					size_t pos = (chunk.used + alignment - 1) & ~(alignment - 1);
+
+					if (pos + size <= chunk.size)
+					{
+						chunk.used = pos + size;
+						return chunk.data + pos;
+					}
+				}
+
+				size_t chunk_size = MIN_CHUNK_SIZE;
+				while (chunk_size < size + alignment)
+					chunk_size *= 2;
+
+				raz::Allocator<char> alloc(m_memory);
+				Chunk chunk = { alloc.allocate(chunk_size), chunk_size, 0 };
+				m_chunks.push_back(chunk);
+				m_chunk = m_chunks.size() - 1;
+
+				return allocate(size, alignment);
+			}
+		};
 
 		IMemoryPool* m_memory;
 		std::thread m_thread;
 		std::promise<void> m_exit_token;
 		std::promise<void> m_thread_result;
 		std::mutex m_mutex;
-		ForwardedCallQueue m_call_queue;
+		CallQueue m_call_queue;
+		std::mutex m_object_mutex; // separate from m_mutex, stop() holds that one while joining
+		T* m_object;
+
+		class ObjectGuard
+		{
+		public:
+			ObjectGuard(Thread* thread, T* object) : m_thread(thread)
+			{
+				std::lock_guard<std::mutex> guard(m_thread->m_object_mutex);
+				m_thread->m_object = object;
+			}
+
+			~ObjectGuard()
+			{
+				std::lock_guard<std::mutex> guard(m_thread->m_object_mutex);
+				m_thread->m_object = nullptr;
+			}
+
+		private:
+			Thread* m_thread;
+		};
+
+		void wakeUp()
+		{
+			std::lock_guard<std::mutex> guard(m_object_mutex);
+			if (m_object)
+				wakeUp(m_object, 0);
+		}
+
+		template<class U>
+		static auto wakeUp(U* object, int) -> decltype(object->wakeUp(), void())
+		{
+			object->wakeUp();
+		}
+
+		template<class U>
+		static void wakeUp(U* object, long)
+		{
+		}
 
 		template<class... Args>
 		class OpCaller
@@ -154,21 +360,22 @@ namespace raz
 			try
 			{
 				T object(std::forward<Args>(args)...);
+				ObjectGuard object_guard(this, &object);
 
 				std::future<void> exit_token = m_exit_token.get_future();
-				ForwardedCallQueue call_queue(m_memory);
+				CallQueue call_queue(m_memory);
 
 				for (;;)
 				{
 					m_mutex.lock();
-					std::swap(m_call_queue, call_queue);
+					m_call_queue.swap(call_queue);
 					m_mutex.unlock();
 
-					for (auto& call : call_queue)
+					for (size_t i = 0; i < call_queue.size(); ++i)
 					{
 						try
 						{
-							call(object);
+							call_queue.invoke(i, object);
 						}
 						catch (ThreadStop)
 						{
@@ -21,6 +21,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE
 
 #pragma once
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 
@@ -79,4 +80,45 @@ namespace raz
 		std::chrono::steady_clock::time_point m_start_time;
 		uint64_t m_last_elapsed;
 	};
+
+	/*
+	 * Allows 'rate' actions per second on average and bursts of up to 'burst' actions
+	 */
+	class TokenBucket
+	{
+	public:
+		TokenBucket(float rate = 1.f, float burst = 1.f)
+		{
+			setLimit(rate, burst);
+		}
+
+		void setLimit(float rate, float burst)
+		{
+			m_rate = rate / 1000.f;
+			m_burst = burst;
+			m_tokens = burst;
+			m_last_time = std::chrono::steady_clock::now();
+		}
+
+		bool consume(float tokens = 1.f)
+		{
+			auto now = std::chrono::steady_clock::now();
+			float elapsed = std::chrono::duration<float, std::milli>(now - m_last_time).count();
+
+			m_last_time = now;
+			m_tokens = std::min(m_burst, m_tokens + elapsed * m_rate);
+
+			if (m_tokens < tokens)
+				return false;
+
+			m_tokens -= tokens;
+			return true;
+		}
+
+	private:
+		float m_rate; // tokens per ms
+		float m_burst;
+		float m_tokens;
+		std::chrono::steady_clock::time_point m_last_time;
+	};
 };